@@ -0,0 +1,12 @@
+// Warning: This is a generated file. Do not modify directly.
+#include <iostream>
+#include "cppx/json.hpp"
+#include "cppx/page.hpp"
+
+#define getPageFunction cppx_route_0
+#define getAsyncPageFunction cppx_route_0
+namespace {
+#include "../../../router/example/page.cpp"
+}
+#undef getPageFunction
+#undef getAsyncPageFunction
@@ -0,0 +1,7 @@
+// WARNING: This file has been automatically generated or modified.
+// Any manual changes may be overwritten in future updates.
+
+#include <iostream>
+
+#include "cppx/json.hpp"
+#include "cppx/page.hpp"
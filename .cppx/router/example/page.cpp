@@ -0,0 +1,66 @@
+// Warning: This is a generated file. Do not modify directly.
+// WARNING: This file has been automatically generated or modified.
+// Any manual changes may be overwritten in future updates.
+
+#include <iostream>
+
+#include "cppx/json.hpp"
+#include "cppx/page.hpp"
+
+Page LandingPage() {
+  return (
+    
+JSON {
+  "html", {
+    "children", JSON::Array {
+      JSON {
+        "head", {
+          "children", JSON::Array {
+            JSON {
+              "title", {
+                "children", JSON::Array {
+                  "CPPX"
+                }
+              }
+            }
+          }
+        }
+      },
+      JSON {
+        "body", {
+          "children", JSON::Array {
+            JSON {
+              "h1", {
+                "children", JSON::Array {
+                  "CPPX"
+                }
+              }
+            },
+            JSON {
+              "p", {
+                "children", JSON::Array {
+                  "A high-performance reactive web framework in C++"
+                }
+              }
+            },
+            JSON {
+              "button", {
+                "onclick", []() {
+                  std::cout << "Hello, world!" << std::endl;
+                },
+                "children", JSON::Array {
+                  "Click me!"
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+  );
+}
+
+extern "C" PageFunction getPageFunction() { return &LandingPage; }
@@ -0,0 +1,11 @@
+// Warning: This is a generated file. Do not modify directly.
+#include <utility>
+#include "cppx/server.hpp"
+
+int main(int argc, char* argv[]) {
+    ServerOptions options = ServerOptions::parse(argc, argv);
+    options.routerDirectory = ".cppx/build/example/bin/router/example";
+
+    Server server(std::move(options));
+    return server.run();
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "cppx/html.hpp"
+#include "cppx/server.hpp"
+#include "load.hpp"
+
+// Both pages wait on a 50 ms backend; the blocking one holds a worker while it waits, the async one suspends.
+constexpr std::chrono::milliseconds backendLatency{50};
+
+Page BlockingPage() {
+  uncacheable();
+  std::this_thread::sleep_for(backendLatency);
+  return JSON{"html", {"children", JSON::Array{JSON{"body", {"children", JSON::Array{"done"}}}}}};
+}
+
+AsyncPage SuspendingPage() {
+  uncacheable();
+  co_await sleepFor(backendLatency);
+  co_return JSON{"html", {"children", JSON::Array{JSON{"body", {"children", JSON::Array{"done"}}}}}};
+}
+
+int main(int argc, char* argv[]) {
+  size_t threads = ThreadPool::defaultThreads();
+  LoadOptions load;
+  load.port = 18082;
+  load.connections = 256;
+  load.duration = std::chrono::milliseconds(3000);
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-t" || argument == "--threads") && i + 1 < argc) {
+      threads = std::stoul(argv[++i]);
+    } else if ((argument == "-c" || argument == "--connections") && i + 1 < argc) {
+      load.connections = std::stoul(argv[++i]);
+    } else if ((argument == "-d" || argument == "--duration") && i + 1 < argc) {
+      load.duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000));
+    }
+  }
+
+  std::cout << "page,connections,requests_per_second,errors" << std::endl;
+
+  // A server per page: blocking renders still queued when a run ends would stall the next one.
+  for (bool async : {false, true}) {
+    ServerOptions options;
+    options.host = load.host;
+    options.port = load.port;
+    options.threads = threads;
+    if (async) {
+      options.asyncRoutes = {{"", &SuspendingPage}};
+    } else {
+      options.routes = {{"", &BlockingPage}};
+    }
+
+    Server server(std::move(options));
+    std::thread serving([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    LoadResult result = LoadGenerator::run(load);
+
+    server.stop();
+    serving.join();
+
+    std::cout << (async ? "async" : "blocking") << "," << load.connections << "," << static_cast<uint64_t>(result.rate()) << "," << result.errors << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cppx/server.hpp"
+#include "load.hpp"
+
+// Serves the built example pages at several compression levels and reports throughput against response size.
+// Run the app builder first so the example router is available.
+int main(int argc, char* argv[]) {
+  std::filesystem::path routerDirectory = ".cppx/build/example/bin/router/example";
+  std::vector<std::string> paths;
+  std::vector<int> levels = {0, 1, 3, 6, 9};
+  LoadOptions load;
+  load.port = 18081;
+  load.connections = 16;
+  load.pipeline = 4;
+  load.duration = std::chrono::milliseconds(2000);
+  load.headers = "Accept-Encoding: gzip\r\n";
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if (argument == "--router" && i + 1 < argc) {
+      routerDirectory = argv[++i];
+    } else if ((argument == "-d" || argument == "--duration") && i + 1 < argc) {
+      load.duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000));
+    } else if ((argument == "-c" || argument == "--connections") && i + 1 < argc) {
+      load.connections = std::stoul(argv[++i]);
+    } else if (argument[0] == '/') {
+      paths.push_back(argument);
+    }
+  }
+  if (paths.empty()) {
+    paths.push_back("/");
+  }
+
+  std::cout << "path,cache,level,requests_per_second,bytes_per_response,errors" << std::endl;
+
+  for (const auto& path : paths) {
+    for (bool cache : {false, true}) {
+      for (int level : levels) {
+        // Cached pages are precompressed at the best level whatever the setting, so one row covers them.
+        if (cache && level != levels.back()) continue;
+
+        ServerOptions options;
+        options.host = load.host;
+        options.port = load.port;
+        options.routerDirectory = routerDirectory;
+        options.hotReload = false;
+        options.compressionLevel = level;
+        options.renderCache = cache;
+
+        Server server(std::move(options));
+        std::thread serving([&server] { server.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        load.path = path;
+        LoadResult result = LoadGenerator::run(load);
+
+        server.stop();
+        serving.join();
+
+        std::cout << path << "," << (cache ? "on" : "off") << "," << level << "," << static_cast<uint64_t>(result.rate()) << ","
+                  << (result.responses ? result.bytes / result.responses : 0) << "," << result.errors << std::endl;
+      }
+    }
+  }
+
+  return 0;
+}
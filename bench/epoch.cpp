@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cppx/epoch.hpp"
+
+// Stress test for Epoch: writers keep replacing a shared object and retiring the old one while readers pin it. Reclaiming
+// only marks an object, so a reader that still sees a reclaimed object is counted instead of touching freed memory.
+// Exits with 1 if any reader did.
+struct Object {
+  std::atomic<bool> reclaimed{false};
+};
+
+int main(int argc, char* argv[]) {
+  size_t readers = std::max(2u, std::thread::hardware_concurrency());
+  size_t writers = 2;
+  auto duration = std::chrono::milliseconds(2000);
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-d" || argument == "--duration") && i + 1 < argc) {
+      duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000));
+    } else if (argument == "--readers" && i + 1 < argc) {
+      readers = std::stoul(argv[++i]);
+    } else if (argument == "--writers" && i + 1 < argc) {
+      writers = std::stoul(argv[++i]);
+    }
+  }
+
+  std::mutex objectsMutex;
+  std::vector<std::unique_ptr<Object>> objects;
+  objects.push_back(std::make_unique<Object>());
+  std::atomic<Object*> current{objects.back().get()};
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> reads{0}, retires{0}, reclaims{0}, violations{0};
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i < readers; ++i) {
+    threads.emplace_back([&] {
+      uint64_t count = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        Epoch::Guard guard;
+        Object* object = current.load(std::memory_order_seq_cst);
+        for (int check = 0; check < 4; ++check) {
+          if (object->reclaimed.load(std::memory_order_seq_cst)) {
+            violations++;
+            break;
+          }
+          std::this_thread::yield();
+        }
+        count++;
+      }
+      reads += count;
+    });
+  }
+
+  for (size_t i = 0; i < writers; ++i) {
+    threads.emplace_back([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        Object* fresh;
+        {
+          std::lock_guard<std::mutex> lock(objectsMutex);
+          objects.push_back(std::make_unique<Object>());
+          fresh = objects.back().get();
+        }
+        Object* previous = current.exchange(fresh, std::memory_order_seq_cst);
+        Epoch::retire([previous, &reclaims] {
+          previous->reclaimed.store(true, std::memory_order_seq_cst);
+          reclaims++;
+        });
+        retires++;
+        Epoch::collect();
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  Epoch::collect();
+
+  std::cout << "readers,writers,reads,retires,reclaims,violations" << std::endl;
+  std::cout << readers << "," << writers << "," << reads << "," << retires << "," << reclaims << "," << violations << std::endl;
+  return violations == 0 ? 0 : 1;
+}
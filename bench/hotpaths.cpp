@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cppx/html.hpp"
+#include "cppx/json.hpp"
+#include "cppx/preprocessor.hpp"
+
+// Times JSON parsing, stringifying and key lookup, page tree building and rendering, and the .cppx preprocessor.
+// Corpora are generated in the shape of the usual JSON benchmark files, with integers kept to JSON::Integer's range.
+// With --baseline, a case whose throughput fell by more than the tolerance is reported and the run fails; --save
+// writes a new baseline.
+
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+
+// Every form of new goes through aligned_alloc and every delete through free, one pair for all of them.
+void* allocate(size_t size, size_t alignment) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  alignment = std::max(alignment, alignof(std::max_align_t));
+  if (void* pointer = std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment)) return pointer;
+  throw std::bad_alloc();
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+namespace {
+
+struct Result {
+  std::string name;
+  size_t iterations = 0;
+  double throughput = 0;
+  std::string unit;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double allocations = 0;
+};
+
+// Runs body in batches for about duration. work is what one call does, in millions of unit.
+Result measure(const std::string& name, const std::string& unit, double work, size_t batch, std::chrono::milliseconds duration, const std::function<void()>& body) {
+  using Clock = std::chrono::steady_clock;
+  body();
+
+  std::vector<double> micros;
+  uint64_t allocations = allocationCount.load(std::memory_order_relaxed);
+  auto start = Clock::now();
+  while (micros.size() < 5 || Clock::now() - start < duration) {
+    auto begin = Clock::now();
+    for (size_t i = 0; i < batch; ++i) {
+      body();
+    }
+    micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count() / static_cast<double>(batch));
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  allocations = allocationCount.load(std::memory_order_relaxed) - allocations;
+
+  Result result;
+  result.name = name;
+  result.iterations = micros.size() * batch;
+  result.throughput = work * static_cast<double>(result.iterations) / seconds;
+  result.unit = unit;
+  result.allocations = static_cast<double>(allocations) / static_cast<double>(result.iterations);
+
+  std::sort(micros.begin(), micros.end());
+  auto percentile = [&micros](double fraction) { return micros[std::min(micros.size() - 1, static_cast<size_t>(fraction * static_cast<double>(micros.size())))]; };
+  result.p50 = percentile(0.5);
+  result.p90 = percentile(0.9);
+  result.p99 = percentile(0.99);
+  return result;
+}
+
+std::string word(std::mt19937& random) {
+  static const char* words[] = {"cppx", "render", "page", "server", "fast", "tree", "node", "json", "route", "signal", "yield", "stream"};
+  return words[random() % (sizeof(words) / sizeof(words[0]))];
+}
+
+// Tweets: mostly strings, with escapes and non-ASCII text, in deep objects.
+std::string twitterCorpus() {
+  std::mt19937 random(1);
+  std::ostringstream output;
+  output << "{\"statuses\":[";
+  for (int i = 0; i < 400; ++i) {
+    int id = 505874924 + i;
+    output << (i ? "," : "") << "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":" << id
+           << ",\"id_str\":\"" << id << "\",\"text\":\"@" << word(random) << " \\u3042\\u308a\\u304c\\u3068\\u3046 " << word(random) << " \\\"" << word(random)
+           << "\\\"\\n" << word(random) << " 日本語のテキスト " << word(random) << "\",\"source\":\"<a href=\\\"https://example.com/\\\" rel=\\\"nofollow\\\">cppx</a>\","
+           << "\"truncated\":false,\"in_reply_to_status_id\":null,\"user\":{\"id\":" << random() % 100000000 << ",\"name\":\"" << word(random) << "\",\"screen_name\":\""
+           << word(random) << i << "\",\"location\":\"東京\",\"description\":\"" << word(random) << " " << word(random) << " " << word(random)
+           << "\",\"url\":null,\"entities\":{\"description\":{\"urls\":[]}},\"protected\":false,\"followers_count\":" << random() % 10000 << ",\"friends_count\":"
+           << random() % 10000 << ",\"verified\":false,\"profile_image_url\":\"http://example.com/profile_images/" << random() << "/normal.jpeg\"},\"geo\":null,"
+           << "\"retweet_count\":" << random() % 100 << ",\"favorite_count\":" << random() % 100 << ",\"entities\":{\"hashtags\":[{\"text\":\"" << word(random)
+           << "\",\"indices\":[" << random() % 50 << "," << random() % 50 + 50 << "]}],\"symbols\":[],\"urls\":[],\"user_mentions\":[]},\"favorited\":false,"
+           << "\"retweeted\":false,\"lang\":\"ja\"}";
+  }
+  output << "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924,\"count\":400}}";
+  return output.str();
+}
+
+// A GeoJSON border: almost nothing but floating point coordinate pairs.
+std::string canadaCorpus() {
+  std::mt19937 random(2);
+  std::uniform_real_distribution<double> longitude(-141.0, -52.0);
+  std::uniform_real_distribution<double> latitude(41.0, 83.0);
+  std::ostringstream output;
+  output << std::setprecision(15) << "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+  for (int ring = 0; ring < 40; ++ring) {
+    output << (ring ? "," : "") << "[";
+    for (int point = 0; point < 1000; ++point) {
+      output << (point ? "," : "") << "[" << longitude(random) << "," << latitude(random) << "]";
+    }
+    output << "]";
+  }
+  output << "]}}]}";
+  return output.str();
+}
+
+// An event catalogue: integers, short keys and many small objects and arrays.
+std::string citmCorpus() {
+  std::mt19937 random(3);
+  std::ostringstream output;
+  output << "{\"areaNames\":{";
+  for (int i = 0; i < 200; ++i) {
+    output << (i ? "," : "") << "\"" << 205705993 + i << "\":\"" << word(random) << " " << word(random) << "\"";
+  }
+  output << "},\"events\":{";
+  for (int i = 0; i < 200; ++i) {
+    output << (i ? "," : "") << "\"" << 138586341 + i << "\":{\"description\":null,\"id\":" << 138586341 + i << ",\"logo\":null,\"name\":\"" << word(random)
+           << "\",\"subTopicIds\":[" << 337184269 + i % 7 << "," << 337184283 + i % 5 << "],\"subjectCode\":null,\"subtitle\":null,\"topicIds\":[" << 324846099 + i % 3
+           << "," << 107888604 + i % 11 << "]}";
+  }
+  output << "},\"performances\":[";
+  for (int i = 0; i < 600; ++i) {
+    output << (i ? "," : "") << "{\"eventId\":" << 138586341 + i % 200 << ",\"id\":" << 339887544 + i << ",\"logo\":null,\"name\":null,\"prices\":[";
+    for (int price = 0; price < 4; ++price) {
+      output << (price ? "," : "") << "{\"amount\":" << (random() % 200 + 10) * 100 << ",\"audienceSubCategoryId\":337100890,\"seatCategoryId\":" << 338937295 + price << "}";
+    }
+    output << "],\"seatCategories\":[";
+    for (int category = 0; category < 4; ++category) {
+      output << (category ? "," : "") << "{\"areas\":[{\"areaId\":" << 205705999 + category << ",\"blockIds\":[]},{\"areaId\":" << 205705998 + category
+             << ",\"blockIds\":[]}],\"seatCategoryId\":" << 338937295 + category << "}";
+    }
+    output << "],\"seatMapImage\":null,\"start\":" << 1372701600 + i * 3600 << ",\"venueCode\":\"PLEYEL_PLEYEL\"}";
+  }
+  output << "]}";
+  return output.str();
+}
+
+// The page the example app ships, as the preprocessor generates it.
+JSON landingPage() {
+  return JSON{"html", {"children", JSON::Array{JSON{"head", {"children", JSON::Array{JSON{"title", {"children", JSON::Array{"CPPX"}}}}}},
+                                               JSON{"body", {"children", JSON::Array{JSON{"h1", {"children", JSON::Array{"CPPX"}}},
+                                                                                      JSON{"p", {"children", JSON::Array{"A high-performance reactive web framework in C++"}}},
+                                                                                      JSON{"button", {"onclick", [] {}, "children", JSON::Array{"Click me!"}}}}}}}}};
+}
+
+const std::string landingSource = R"(Page LandingPage() {
+  return (
+    <html>
+      <head>
+        <title>CPPX</title>
+      </head>
+      <body>
+        <h1>CPPX</h1>
+        <p>A high-performance reactive web framework in C++</p>
+        <button
+          onclick={[]() {
+            std::cout << "Hello, world!" << std::endl;
+          }}
+        >
+          Click me!
+        </button>
+      </body>
+    </html>
+  );
+}
+)";
+
+// A larger page: a table built in a loop, with attributes, expressions and nested markup.
+std::string tableSource() {
+  std::ostringstream output;
+  output << "#include <string>\n\nPage TablePage() {\n  std::string title = \"Report\";\n  return (\n    <html>\n      <head>\n        <title>{title}</title>\n      </head>\n      <body>\n";
+  for (int section = 0; section < 40; ++section) {
+    output << "        <section class=\"section-" << section << "\" id=\"s" << section << "\">\n          <h2>Section " << section << "</h2>\n          <table class=\"grid\">\n";
+    for (int row = 0; row < 5; ++row) {
+      output << "            <tr>\n              <td class=\"name\">Row " << row << "</td>\n              <td>{std::to_string(" << section * 5 + row
+             << ")}</td>\n              <td><a href=\"/item/" << row << "\">Open</a></td>\n            </tr>\n";
+    }
+    output << "          </table>\n        </section>\n";
+  }
+  output << "      </body>\n    </html>\n  );\n}\n";
+  return output.str();
+}
+
+std::vector<Result> runAll(std::chrono::milliseconds duration, const std::string& filter) {
+  std::vector<Result> results;
+  volatile size_t sink = 0;
+  auto run = [&](const std::string& name, const std::string& unit, double work, size_t batch, const std::function<void()>& body) {
+    if (name.find(filter) != std::string::npos) {
+      results.push_back(measure(name, unit, work, batch, duration, body));
+    }
+  };
+
+  const std::vector<std::pair<std::string, std::string>> corpora = {{"twitter", twitterCorpus()}, {"canada", canadaCorpus()}, {"citm", citmCorpus()}};
+  for (const auto& [name, text] : corpora) {
+    run("parse/" + name, "MB/s", static_cast<double>(text.size()) / 1e6, 1, [&] { sink = sink + (JSON::parse(text).type() == JSON::Type::Object); });
+  }
+  for (const auto& [name, text] : corpora) {
+    JSON document = JSON::parse(text);
+    double size = static_cast<double>(document.stringify().size()) / 1e6;
+    run("stringify/" + name, "MB/s", size, 1, [&] { sink = sink + document.stringify().size(); });
+  }
+
+  // Lookups miss and hit across an object of the size pages and API payloads usually have.
+  JSON::Object fields;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 24; ++i) {
+    keys.push_back("field_" + std::to_string(i * 7919 % 1000));
+    fields.emplace_back(keys.back(), JSON(static_cast<JSON::Integer>(i)));
+  }
+  const JSON object(std::move(fields));
+  run("lookup/object", "Mop/s", static_cast<double>(keys.size()) / 1e6, 256, [&] {
+    for (const auto& key : keys) {
+      sink = sink + (object[key].type() == JSON::Type::Integer);
+    }
+  });
+
+  run("tree/landing", "Mop/s", 1e-6, 256, [&] { sink = sink + (landingPage().type() == JSON::Type::Object); });
+  const JSON landing = landingPage();
+  run("render/landing", "Mop/s", 1e-6, 256, [&] {
+    std::string html;
+    Html::render(landing, html);
+    sink = sink + html.size();
+  });
+
+  const std::string table = tableSource();
+  // Diagnostics go to a stream without a buffer, which drops them.
+  std::ostream diagnostics(nullptr);
+  run("preprocess/landing", "MB/s", static_cast<double>(landingSource.size()) / 1e6, 16, [&] { sink = sink + Preprocessor::Process(landingSource, diagnostics).size(); });
+  run("preprocess/table", "MB/s", static_cast<double>(table.size()) / 1e6, 1, [&] { sink = sink + Preprocessor::Process(table, diagnostics).size(); });
+
+  return results;
+}
+
+void print(const std::vector<Result>& results, std::ostream& output) {
+  output << "case,iterations,throughput,unit,p50_us,p90_us,p99_us,allocations_per_op\n";
+  for (const auto& result : results) {
+    output << result.name << "," << result.iterations << "," << std::fixed << std::setprecision(2) << result.throughput << "," << result.unit << "," << std::setprecision(3)
+           << result.p50 << "," << result.p90 << "," << result.p99 << "," << std::setprecision(1) << result.allocations << std::defaultfloat << "\n";
+  }
+}
+
+std::map<std::string, Result> readBaseline(const std::string& path) {
+  std::map<std::string, Result> baseline;
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields;
+    std::istringstream input(line);
+    for (std::string field; std::getline(input, field, ',');) {
+      fields.push_back(field);
+    }
+    if (fields.size() == 8) {
+      Result& result = baseline[fields[0]];
+      result.name = fields[0];
+      result.throughput = std::stod(fields[2]);
+      result.unit = fields[3];
+      result.allocations = std::stod(fields[7]);
+    }
+  }
+  return baseline;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::chrono::milliseconds duration(500);
+  std::string filter;
+  std::string baselinePath;
+  std::string savePath;
+  double tolerance = 0.1;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-d" || argument == "--duration") && i + 1 < argc) {
+      duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000));
+    } else if (argument == "--baseline" && i + 1 < argc) {
+      baselinePath = argv[++i];
+    } else if (argument == "--save" && i + 1 < argc) {
+      savePath = argv[++i];
+    } else if (argument == "--tolerance" && i + 1 < argc) {
+      tolerance = std::stod(argv[++i]);
+    } else if (argument[0] != '-') {
+      filter = argument;
+    }
+  }
+
+  std::vector<Result> results = runAll(duration, filter);
+  print(results, std::cout);
+
+  if (!savePath.empty()) {
+    std::ofstream file(savePath);
+    print(results, file);
+  }
+
+  if (baselinePath.empty()) {
+    return 0;
+  }
+  std::map<std::string, Result> baseline = readBaseline(baselinePath);
+  if (baseline.empty()) {
+    std::cerr << "Error: No baseline results in " << baselinePath << std::endl;
+    return 1;
+  }
+
+  int regressions = 0;
+  for (const auto& result : results) {
+    auto previous = baseline.find(result.name);
+    if (previous == baseline.end()) {
+      continue;
+    }
+    // Allocation counts do not depend on the machine, so a small rise is already a change in the code.
+    const Result& before = previous->second;
+    if (before.throughput > 0 && result.throughput < before.throughput * (1 - tolerance)) {
+      std::cerr << "Regression: " << result.name << " " << std::fixed << std::setprecision(2) << result.throughput << " " << result.unit << " against " << before.throughput << " ("
+                << std::setprecision(1) << (result.throughput / before.throughput - 1) * 100 << "%)" << std::defaultfloat << std::endl;
+      regressions++;
+    }
+    if (result.allocations > before.allocations + 0.5) {
+      std::cerr << "Regression: " << result.name << " " << std::fixed << std::setprecision(1) << result.allocations << " allocations per op against " << before.allocations
+                << std::defaultfloat << std::endl;
+      regressions++;
+    }
+  }
+  return regressions > 0 ? 1 : 0;
+}
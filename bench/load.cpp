@@ -0,0 +1,36 @@
+#include <iostream>
+#include <string>
+
+#include "load.hpp"
+
+int main(int argc, char* argv[]) {
+  LoadOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-p" || argument == "--port") && i + 1 < argc) {
+      options.port = static_cast<uint16_t>(std::stoi(argv[++i]));
+    } else if (argument == "--host" && i + 1 < argc) {
+      options.host = argv[++i];
+    } else if ((argument == "-c" || argument == "--connections") && i + 1 < argc) {
+      options.connections = std::stoul(argv[++i]);
+    } else if ((argument == "-t" || argument == "--threads") && i + 1 < argc) {
+      options.threads = std::stoul(argv[++i]);
+    } else if (argument == "--pipeline" && i + 1 < argc) {
+      options.pipeline = std::stoul(argv[++i]);
+    } else if ((argument == "-d" || argument == "--duration") && i + 1 < argc) {
+      options.duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000));
+    } else if ((argument == "-H" || argument == "--header") && i + 1 < argc) {
+      options.headers += std::string(argv[++i]) + "\r\n";
+    } else if (argument[0] == '/') {
+      options.path = argument;
+    } else {
+      std::cerr << "Usage: load [--host HOST] [-p PORT] [-c CONNECTIONS] [-t THREADS] [--pipeline DEPTH] [-d SECONDS] [-H HEADER] [PATH]" << std::endl;
+      return 1;
+    }
+  }
+
+  LoadResult result = LoadGenerator::run(options);
+  std::cout << "responses=" << result.responses << " errors=" << result.errors << " bytes=" << result.bytes << " seconds=" << result.seconds << " rate=" << static_cast<uint64_t>(result.rate()) << std::endl;
+  return result.errors == 0 ? 0 : 1;
+}
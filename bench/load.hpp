@@ -0,0 +1,176 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct LoadOptions {
+  std::string host = "127.0.0.1";
+  uint16_t port = 8080;
+  std::string path = "/";
+  std::string headers;
+  size_t connections = 64;
+  size_t threads = 1;
+  size_t pipeline = 1;
+  std::chrono::milliseconds duration{5000};
+};
+
+struct LoadResult {
+  uint64_t responses = 0;
+  uint64_t errors = 0;
+  uint64_t bytes = 0;
+  double seconds = 0;
+
+  double rate() const { return seconds > 0 ? static_cast<double>(responses) / seconds : 0; }
+};
+
+class LoadGenerator {
+ public:
+  static LoadResult run(const LoadOptions& options) {
+    std::atomic<bool> running{true};
+    std::vector<LoadResult> results(options.threads);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.threads; ++i) {
+      size_t connections = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+      threads.emplace_back([&, i, connections] { drive(options, connections, running, results[i]); });
+    }
+
+    std::this_thread::sleep_for(options.duration);
+    running = false;
+    for (auto& thread : threads) thread.join();
+
+    LoadResult total;
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& result : results) {
+      total.responses += result.responses;
+      total.errors += result.errors;
+      total.bytes += result.bytes;
+    }
+    return total;
+  }
+
+ private:
+  struct Client {
+    int fd = -1;
+    std::string input;
+    size_t inFlight = 0;
+  };
+
+  // Returns the size of the first complete response in the buffer, 0 when more bytes are needed.
+  static size_t responseSize(std::string_view buffer) {
+    size_t headerEnd = buffer.find("\r\n\r\n");
+    if (headerEnd == std::string_view::npos) return 0;
+    std::string_view head = buffer.substr(0, headerEnd);
+
+    if (head.find("Transfer-Encoding: chunked") != std::string_view::npos) {
+      size_t offset = headerEnd + 4;
+      while (true) {
+        size_t lineEnd = buffer.find("\r\n", offset);
+        if (lineEnd == std::string_view::npos) return 0;
+        size_t length = std::stoul(std::string(buffer.substr(offset, lineEnd - offset)), nullptr, 16);
+        offset = lineEnd + 2 + length + 2;
+        if (offset > buffer.size()) return 0;
+        if (length == 0) return offset;
+      }
+    }
+
+    size_t length = 0;
+    size_t field = head.find("Content-Length: ");
+    if (field != std::string_view::npos) {
+      for (size_t i = field + 16; i < headerEnd && buffer[i] >= '0' && buffer[i] <= '9'; ++i) {
+        length = length * 10 + static_cast<size_t>(buffer[i] - '0');
+      }
+    }
+
+    size_t total = headerEnd + 4 + length;
+    return buffer.size() >= total ? total : 0;
+  }
+
+  static int connect(const LoadOptions& options) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+      if (fd >= 0) ::close(fd);
+      return -1;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+  }
+
+  static void drive(const LoadOptions& options, size_t connections, const std::atomic<bool>& running, LoadResult& result) {
+    std::string request = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host + "\r\n" + options.headers + "\r\n";
+    std::string batch;
+    for (size_t i = 0; i < options.pipeline; ++i) batch += request;
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Client> clients(connections);
+    for (size_t i = 0; i < clients.size(); ++i) {
+      clients[i].fd = connect(options);
+      if (clients[i].fd < 0) {
+        result.errors++;
+        continue;
+      }
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.u64 = i;
+      epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &event);
+      (void)!send(clients[i].fd, batch.data(), batch.size(), MSG_NOSIGNAL);
+      clients[i].inFlight = options.pipeline;
+    }
+
+    epoll_event events[256];
+    char buffer[64 * 1024];
+    while (running.load(std::memory_order_relaxed)) {
+      int count = epoll_wait(epollFd, events, 256, 10);
+      for (int e = 0; e < count; ++e) {
+        Client& client = clients[events[e].data.u64];
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+          result.errors++;
+          epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+          ::close(client.fd);
+          client.fd = -1;
+          continue;
+        }
+
+        client.input.append(buffer, static_cast<size_t>(received));
+        size_t offset = 0;
+        while (size_t size = responseSize(std::string_view(client.input).substr(offset))) {
+          if (client.input.compare(offset, 12, "HTTP/1.1 200") != 0) result.errors++;
+          offset += size;
+          result.bytes += size;
+          client.inFlight--;
+          result.responses++;
+        }
+        client.input.erase(0, offset);
+
+        if (client.inFlight == 0) {
+          (void)!send(client.fd, batch.data(), batch.size(), MSG_NOSIGNAL);
+          client.inFlight = options.pipeline;
+        }
+      }
+    }
+
+    for (const auto& client : clients) {
+      if (client.fd >= 0) ::close(client.fd);
+    }
+    ::close(epollFd);
+  }
+};
@@ -0,0 +1,57 @@
+#include <atomic>
+#include <iostream>
+#include <string>
+
+#include "cppx/html.hpp"
+#include "cppx/server.hpp"
+
+// Checks that render caching is opt-in: a page that declares nothing is rendered on every request, while one that calls
+// cacheable() is rendered once and then served from the cache. Exits with 1 if either is not so.
+namespace {
+
+std::atomic<int> plainRenders{0};
+std::atomic<int> cacheableRenders{0};
+
+Page PlainPage() {
+  plainRenders++;
+  return JSON{"html", {"children", JSON::Array{JSON{"body", {"children", JSON::Array{"plain"}}}}}};
+}
+
+Page CacheablePage() {
+  cacheable();
+  cacheableRenders++;
+  return JSON{"html", {"children", JSON::Array{JSON{"body", {"children", JSON::Array{"cacheable"}}}}}};
+}
+
+bool fetch(Server& server, std::string_view path) {
+  HttpRequest request;
+  request.method = "GET";
+  request.target = path;
+  request.path = path;
+  HttpResponse response;
+  server.handle(request, response);
+  return response.status == 200;
+}
+
+}  // namespace
+
+int main() {
+  ServerOptions options;
+  options.routes = {{"plain", &PlainPage}, {"cacheable", &CacheablePage}};
+  Server server(std::move(options));
+
+  constexpr int requests = 3;
+  bool ok = true;
+
+  for (int i = 0; i < requests; ++i) {
+    ok = fetch(server, "/plain") && ok;
+    ok = fetch(server, "/cacheable") && ok;
+  }
+
+  std::cout << "page,requests,renders" << std::endl;
+  std::cout << "plain," << requests << "," << plainRenders << std::endl;
+  std::cout << "cacheable," << requests << "," << cacheableRenders << std::endl;
+
+  ok = ok && plainRenders == requests && cacheableRenders == 1;
+  return ok ? 0 : 1;
+}
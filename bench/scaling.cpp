@@ -0,0 +1,79 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "cppx/html.hpp"
+#include "cppx/server.hpp"
+#include "load.hpp"
+
+// A render-bound page: a few thousand nodes built and rendered per request.
+Page TablePage() {
+  uncacheable();
+
+  JSON::Array rows;
+  for (int row = 0; row < 200; ++row) {
+    JSON::Array cells;
+    for (int column = 0; column < 8; ++column) {
+      cells.push_back(JSON{"td", {"class", column % 2 ? "odd" : "even", "children", JSON::Array{"cell " + std::to_string(row * 8 + column)}}});
+    }
+    rows.push_back(JSON{"tr", {"children", std::move(cells)}});
+  }
+
+  return JSON{"html", {"children", JSON::Array{JSON{"body", {"children", JSON::Array{JSON{"table", {"children", std::move(rows)}}}}}}}};
+}
+
+int main(int argc, char* argv[]) {
+  size_t maxThreads = ThreadPool::defaultThreads();
+  bool pin = false;
+  bool metrics = false;
+  std::filesystem::path traceFile;
+  LoadOptions load;
+  load.port = 18080;
+  load.duration = std::chrono::milliseconds(3000);
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-t" || argument == "--threads") && i + 1 < argc) {
+      maxThreads = std::stoul(argv[++i]);
+    } else if ((argument == "-c" || argument == "--connections") && i + 1 < argc) {
+      load.connections = std::stoul(argv[++i]);
+    } else if ((argument == "-d" || argument == "--duration") && i + 1 < argc) {
+      load.duration = std::chrono::milliseconds(static_cast<long>(std::stod(argv[++i]) * 1000));
+    } else if (argument == "--pin") {
+      pin = true;
+    } else if (argument == "--metrics") {
+      metrics = true;
+    } else if (argument == "--trace" && i + 1 < argc) {
+      traceFile = argv[++i];
+    }
+  }
+
+  std::cout << "threads,requests_per_second,speedup,errors" << std::endl;
+
+  double baseline = 0;
+  for (size_t threads = 1; threads <= maxThreads; ++threads) {
+    ServerOptions options;
+    options.host = load.host;
+    options.port = load.port;
+    options.threads = threads;
+    options.pinThreads = pin;
+    options.metrics = metrics;
+    options.traceFile = traceFile;
+    options.routes = {{"", &TablePage}};
+
+    Server server(std::move(options));
+    std::thread serving([&server] { server.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    LoadResult result = LoadGenerator::run(load);
+
+    server.stop();
+    serving.join();
+
+    if (threads == 1) baseline = result.rate();
+    std::cout << threads << "," << static_cast<uint64_t>(result.rate()) << "," << std::fixed << std::setprecision(2) << (baseline > 0 ? result.rate() / baseline : 0) << std::defaultfloat << "," << result.errors << std::endl;
+  }
+
+  return 0;
+}
@@ -1,13 +1,22 @@
-#include <chrono>
-#include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include <string>
-#include <thread>
-#include <unordered_map>
 #include <vector>
 
-void build() {
+#include "cppx/build_state.hpp"
+#include "cppx/cache.hpp"
+#include "cppx/profile.hpp"
+#include "cppx/scheduler.hpp"
+#include "cppx/trace.hpp"
+#include "cppx/watcher.hpp"
+#include "src/cppx/build_state.cpp"
+#include "src/cppx/cache.cpp"
+#include "src/cppx/profile.cpp"
+#include "src/cppx/scheduler.cpp"
+#include "src/cppx/trace.cpp"
+#include "src/cppx/watcher.cpp"
+
+void build(size_t jobs, bool bench) {
   const std::filesystem::path include_dir = "include";
   const std::filesystem::path src_dir = "src";
   const std::filesystem::path build_dir = "build/cppx";
@@ -24,22 +33,65 @@ void build() {
   }
 
   std::vector<std::filesystem::path> lib_cpp_files = {
+    "src/cppx/build_state.cpp",
+    "src/cppx/cache.cpp",
+    "src/cppx/compression.cpp",
+    "src/cppx/epoch.cpp",
+    "src/cppx/html.cpp",
+    "src/cppx/http.cpp",
     "src/cppx/json.cpp",
-    "src/cppx/preprocessor.cpp"
+    "src/cppx/patch.cpp",
+    "src/cppx/preprocessor.cpp",
+    "src/cppx/profile.cpp",
+    "src/cppx/render_cache.cpp",
+    "src/cppx/response_writer.cpp",
+    "src/cppx/scheduler.cpp",
+    "src/cppx/session.cpp",
+    "src/cppx/thread_pool.cpp",
+    "src/cppx/trace.cpp",
+    "src/cppx/watcher.cpp",
+    "src/cppx/websocket.cpp"
   };
 
+#if defined(__linux__)
+  lib_cpp_files.push_back("src/cppx/async.cpp");
+  lib_cpp_files.push_back("src/cppx/io_uring.cpp");
+  lib_cpp_files.push_back("src/cppx/reactor.cpp");
+  lib_cpp_files.push_back("src/cppx/router.cpp");
+  lib_cpp_files.push_back("src/cppx/server.cpp");
+  lib_cpp_files.push_back("src/cppx/supervisor.cpp");
+#endif
+
   std::vector<std::filesystem::path> exe_sources = {
     "src/cppx/main.cpp"
   };
 
-  std::vector<std::filesystem::path> lib_object_files;
+  if (bench) {
+    for (const auto &entry : std::filesystem::directory_iterator("bench")) {
+      if (entry.path().extension() == ".cpp") {
+        exe_sources.push_back(entry.path());
+      }
+    }
+  }
 
-  std::cout << "Building library..." << std::endl;
+  Scheduler scheduler(jobs);
+  const BuildState build_state(build_dir / "state");
+
+  auto add_target = [&](const std::string &command, const std::string &error_message, const std::vector<Scheduler::JobId> &dependencies, const std::filesystem::path &output, const std::vector<std::filesystem::path> &inputs, const std::filesystem::path &dependency_file) {
+    return scheduler.add(
+        command, error_message, dependencies,
+        [&build_state, command, output, inputs, dependency_file] { return build_state.upToDate(output, command, inputs, dependency_file); },
+        [&build_state, command, output, inputs, dependency_file] { build_state.record(output, command, inputs, dependency_file); });
+  };
+  std::vector<std::filesystem::path> lib_object_files;
+  std::vector<Scheduler::JobId> lib_object_jobs;
 
   for (const auto &cpp_file : lib_cpp_files) {
     std::filesystem::path relative_path = std::filesystem::relative(cpp_file, src_dir);
     std::filesystem::path object_path = build_lib_dir / src_dir / relative_path;
     object_path.replace_extension(".o");
+    std::filesystem::path dependency_path = object_path;
+    dependency_path.replace_extension(".d");
 
     try {
       std::filesystem::create_directories(object_path.parent_path());
@@ -48,40 +100,30 @@ void build() {
       return;
     }
 
-    std::string compile_cmd = "g++ -c \"" + cpp_file.string() + "\" -I\"" + include_dir.string() + "\" -std=c++20 -O3 -o \"" + object_path.string() + "\"";
-    if (std::system(compile_cmd.c_str()) != 0) {
-      std::cerr << "Error: Compilation failed for " << cpp_file << std::endl;
-      return;
-    }
-
+    std::string compile_cmd = "g++ -c \"" + cpp_file.string() + "\" -I\"" + include_dir.string() + "\" -std=c++20 -O3 -fPIC -flto -ffat-lto-objects -MMD -MF \"" + dependency_path.string() + "\" -o \"" + object_path.string() + "\"";
+    lib_object_jobs.push_back(add_target(compile_cmd, "Compilation failed for " + cpp_file.string(), {}, object_path, {}, dependency_path));
     lib_object_files.push_back(object_path);
   }
 
-  std::cout << "Archiving library..." << std::endl;
-
-  if (!lib_object_files.empty()) {
-    std::filesystem::path archive_path = build_lib_dir / lib_name;
-    std::string archive_cmd = "ar rcs \"" + archive_path.string() + "\"";
-
-    for (const auto &obj : lib_object_files) {
-      archive_cmd += " \"" + obj.string() + "\"";
-    }
-
-    if (std::system(archive_cmd.c_str()) != 0) {
-      std::cerr << "Error: Archiving failed for " << lib_name << std::endl;
-      return;
-    }
-  } else {
+  if (lib_object_files.empty()) {
     std::cerr << "Error: No library source files found to archive." << std::endl;
     return;
   }
 
-  std::cout << "Building executables..." << std::endl;
+  std::filesystem::path archive_path = build_lib_dir / lib_name;
+  std::string archive_cmd = "ar rcs \"" + archive_path.string() + "\"";
+
+  for (const auto &obj : lib_object_files) {
+    archive_cmd += " \"" + obj.string() + "\"";
+  }
+
+  Scheduler::JobId archive_job = add_target(archive_cmd, "Archiving failed for " + lib_name, lib_object_jobs, archive_path, lib_object_files, {});
 
   for (const auto &exe_src : exe_sources) {
-    std::filesystem::path relative_path = std::filesystem::relative(exe_src, src_dir);
-    std::filesystem::path exe_obj_path = build_bin_dir / src_dir / relative_path;
+    std::filesystem::path exe_obj_path = build_bin_dir / exe_src;
     exe_obj_path.replace_extension(".o");
+    std::filesystem::path exe_dependency_path = exe_obj_path;
+    exe_dependency_path.replace_extension(".d");
 
     try {
       std::filesystem::create_directories(exe_obj_path.parent_path());
@@ -90,71 +132,74 @@ void build() {
       return;
     }
 
-    std::string compile_exe_cmd = "g++ -c \"" + exe_src.string() + "\" -I\"" + include_dir.string() + "\" -std=c++20 -O3 -o \"" + exe_obj_path.string() + "\"";
-    if (std::system(compile_exe_cmd.c_str()) != 0) {
-      std::cerr << "Error: Compilation failed for executable source " << exe_src << std::endl;
-      return;
-    }
+    std::string compile_exe_cmd = "g++ -c \"" + exe_src.string() + "\" -I\"" + include_dir.string() + "\" -std=c++20 -O3 -MMD -MF \"" + exe_dependency_path.string() + "\" -o \"" + exe_obj_path.string() + "\"";
+    Scheduler::JobId compile_exe_job = add_target(compile_exe_cmd, "Compilation failed for executable source " + exe_src.string(), {}, exe_obj_path, {}, exe_dependency_path);
 
-    std::filesystem::path exe_output_path = build_bin_dir / src_dir / relative_path;
+    std::filesystem::path exe_output_path = build_bin_dir / exe_src;
     exe_output_path.replace_extension(""); // Remove the .cpp extension
 
-    std::string link_cmd = "g++ \"" + exe_obj_path.string() + "\" -L\"" + build_lib_dir.string() + "\" -lcppx -std=c++20 -O3 -o \"" + exe_output_path.string() + "\"";
-    if (std::system(link_cmd.c_str()) != 0) {
-      std::cerr << "Error: Linking failed for executable " << exe_output_path << std::endl;
-      return;
-    }
+    std::string link_cmd = "g++ \"" + exe_obj_path.string() + "\" -L\"" + build_lib_dir.string() + "\" -lcppx -lz -std=c++20 -O3 -fno-lto -o \"" + exe_output_path.string() + "\"";
+    add_target(link_cmd, "Linking failed for executable " + exe_output_path.string(), {compile_exe_job, archive_job}, exe_output_path, {exe_obj_path, archive_path}, {});
+  }
+
+  std::cout << "Building library and executables with " << jobs << " job(s)..." << std::endl;
+
+  if (!scheduler.run()) {
+    return;
   }
 
   std::cout << "Build completed successfully!" << std::endl;
 }
 
-void watch() {
-  std::unordered_map<std::filesystem::path, std::filesystem::file_time_type> files_last_write_time;
-
-  std::vector<std::string> dirs_to_watch = {
-    "include",
-    "src"
-  };
+void report(const std::filesystem::path &profile_file) {
+  if (!profile_file.empty()) {
+    Profile::summarize(std::cout);
+    Profile::write(profile_file);
+    Profile::clear();
+  }
+}
 
-  for (const auto &dir : dirs_to_watch) {
-    for (const auto &file : std::filesystem::recursive_directory_iterator(dir)) {
-      if (file.is_regular_file()) {
-        files_last_write_time[file.path()] = std::filesystem::last_write_time(file);
-      }
-    }
+void watch(size_t jobs, bool bench, const std::filesystem::path &profile_file) {
+  std::vector<std::filesystem::path> directories = {"include", "src"};
+  if (bench) {
+    directories.push_back("bench");
   }
+  Watcher watcher(directories);
 
-  build();
+  build(jobs, bench);
+  report(profile_file);
 
   std::cout << "Watching for changes..." << std::endl;
 
   while (true) {
-    bool files_changed = false;
-
-    for (const auto &dir : dirs_to_watch) {
-      for (const auto &file : std::filesystem::recursive_directory_iterator(dir)) {
-        if (file.is_regular_file()) {
-          auto current_file_time = std::filesystem::last_write_time(file);
-          if (files_last_write_time[file.path()] != current_file_time) {
-            files_last_write_time[file.path()] = current_file_time;
-            files_changed = true;
-          }
-        }
-      }
-    }
-
-    if (files_changed) build();
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    watcher.wait();
+    build(jobs, bench);
+    report(profile_file);
   }
 }
 
 int main(int argc, char *argv[]) {
-  if (argc > 1 && (std::string(argv[1]) == "-w" || std::string(argv[1]) == "--watch")) {
-    watch();
+  size_t jobs = Scheduler::parseJobs(argc, argv);
+
+  bool watch_mode = false;
+  bool bench = false;
+  std::filesystem::path profile_file;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "-w" || std::string(argv[i]) == "--watch") {
+      watch_mode = true;
+    } else if (std::string(argv[i]) == "--bench") {
+      bench = true;
+    } else if (std::string(argv[i]) == "--profile" && i + 1 < argc) {
+      profile_file = argv[++i];
+      Profile::enable();
+    }
+  }
+
+  if (watch_mode) {
+    watch(jobs, bench, profile_file);
   } else {
-    build();
+    build(jobs, bench);
+    report(profile_file);
   }
 
   return 0;
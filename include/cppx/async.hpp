@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+
+// A lazily started coroutine producing a T. Awaiting it runs it; its awaiter resumes when it finishes.
+template <typename T>
+class Task {
+ public:
+  struct promise_type {
+    std::optional<T> value;
+    std::exception_ptr error;
+    std::coroutine_handle<> continuation;
+    std::function<void()> done;
+
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+      struct Final {
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+          promise_type& promise = handle.promise();
+          if (promise.continuation) {
+            return promise.continuation;
+          }
+          // Moved out first: the callback may destroy this frame.
+          if (auto done = std::move(promise.done)) {
+            done();
+          }
+          return std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+      };
+      return Final{};
+    }
+
+    template <typename U>
+    void return_value(U&& value) {
+      this->value.emplace(std::forward<U>(value));
+    }
+
+    void unhandled_exception() { error = std::current_exception(); }
+  };
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+    handle_.promise().continuation = continuation;
+    return handle_;
+  }
+  T await_resume() { return result(); }
+
+  // Runs a task nobody awaits; done is called on whichever thread finishes it, possibly before start returns.
+  void start(std::function<void()> done) {
+    handle_.promise().done = std::move(done);
+    handle_.resume();
+  }
+
+  T result() {
+    promise_type& promise = handle_.promise();
+    if (promise.error) {
+      std::rethrow_exception(promise.error);
+    }
+    return std::move(*promise.value);
+  }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Awaitables for async pages. They suspend onto the server's event loop; with no server running they block instead.
+class Sleep {
+ public:
+  explicit Sleep(std::chrono::steady_clock::duration duration) : duration_(duration) {}
+
+  bool await_ready();
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+
+ private:
+  std::chrono::steady_clock::duration duration_;
+};
+
+class Readiness {
+ public:
+  Readiness(int fd, uint32_t events) : fd_(fd), events_(events) {}
+
+  bool await_ready();
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+
+ private:
+  int fd_;
+  uint32_t events_;
+};
+
+// Runs blocking work, such as file reads, off both the event loop and the page's worker.
+class Offload {
+ public:
+  explicit Offload(std::function<void()> work) : work_(std::move(work)) {}
+
+  bool await_ready();
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+
+ private:
+  std::function<void()> work_;
+};
+
+Sleep sleepFor(std::chrono::steady_clock::duration duration);
+Readiness readable(int fd);
+Readiness writable(int fd);
+Task<std::string> readFile(std::filesystem::path path);
+// Connects to a Unix socket, sends request, closes the write side and returns everything the peer sends back.
+Task<std::string> querySocket(std::filesystem::path socket, std::string request);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Records what each target was built from and decides whether it is up to date. One instance serves one build run:
+// inputs shared by many targets are hashed once and reused until their size or modification time changes.
+class BuildState {
+ public:
+  explicit BuildState(const std::filesystem::path& directory);
+
+  bool upToDate(const std::filesystem::path& output, const std::string& command, const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile = {}) const;
+  void record(const std::filesystem::path& output, const std::string& command, const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile = {}) const;
+
+  static std::vector<std::filesystem::path> parseDependencyFile(const std::filesystem::path& dependencyFile);
+
+ private:
+  struct Stamp {
+    std::string path;
+    int64_t modified = 0;
+    uintmax_t size = 0;
+    std::string hash;
+  };
+
+  std::filesystem::path directory_;
+  mutable std::mutex hashesMutex_;
+  mutable std::unordered_map<std::string, Stamp> hashes_;
+
+  std::filesystem::path recordPath(const std::filesystem::path& output) const;
+  static std::vector<std::filesystem::path> collectInputs(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile);
+  static bool stat(const std::filesystem::path& path, Stamp& stamp);
+  std::string hash(const Stamp& stamp) const;
+};
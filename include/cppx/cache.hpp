@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+class Cache {
+ public:
+  explicit Cache(const std::filesystem::path& directory);
+
+  std::optional<std::string> get(const std::string& key) const;
+  void put(const std::string& key, const std::string& content) const;
+  // Removes the least recently used entries until the cache holds at most maxBytes.
+  void prune(uintmax_t maxBytes = defaultMaxBytes) const;
+
+  static constexpr uintmax_t defaultMaxBytes = 64 * 1024 * 1024;
+
+  static std::string hash(const std::string& content);
+
+ private:
+  std::filesystem::path directory_;
+
+  std::filesystem::path pathFor(const std::string& key) const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+struct z_stream_s;
+
+class Compression {
+ public:
+  enum class Encoding { Identity, Gzip, Deflate };
+
+  static constexpr int encodingCount = 3;
+  static constexpr int bestLevel = 9;
+
+  class Stream {
+   public:
+    Stream(Encoding encoding, int level);
+    ~Stream();
+
+    Stream(const Stream&) = delete;
+    Stream& operator=(const Stream&) = delete;
+
+    void write(std::string_view input, std::string& output);
+    // Ends the output on a byte boundary, so the client can decode everything written so far.
+    void flush(std::string& output);
+    void finish(std::string& output);
+
+   private:
+    std::unique_ptr<z_stream_s> stream_;
+    int windowBits_;
+    int level_;
+
+    void deflate(std::string_view input, int flush, std::string& output);
+  };
+
+  static Encoding negotiate(std::string_view acceptEncoding);
+  static std::string_view name(Encoding encoding);
+  static std::string compress(std::string_view input, Encoding encoding, int level);
+};
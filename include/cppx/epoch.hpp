@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+class Epoch {
+ public:
+  class Guard {
+   public:
+    Guard();
+    ~Guard();
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    bool outermost_;
+  };
+
+  static void retire(std::function<void()> reclaim);
+  static size_t collect();
+  static size_t pending();
+
+  static constexpr size_t maxThreads = 256;
+};
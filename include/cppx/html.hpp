@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppx/json.hpp"
+
+class Html {
+ public:
+  static std::string render(const JSON& node);
+  static void render(const JSON& node, std::string& output);
+  static void render(const JSON& node, std::string& output, std::vector<const JSON::Callable*>* callables);
+
+  static void collect(const JSON& node, std::vector<const JSON::Callable*>& callables);
+  static void escape(std::string_view text, std::string& output);
+  static bool isVoidElement(const std::string& tagName);
+
+ private:
+  static void renderElement(const std::string& tagName, const JSON& element, std::string& output, std::vector<const JSON::Callable*>* callables);
+  static void renderScalar(const JSON& value, std::string& output);
+};
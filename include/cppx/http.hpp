@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cppx/response_writer.hpp"
+
+struct HttpRequest {
+  enum class ParseResult { Complete, Incomplete, Invalid };
+
+  std::string_view method;
+  std::string_view target;
+  std::string_view path;
+  std::string_view query;
+  std::string_view body;
+  std::vector<std::pair<std::string_view, std::string_view>> headers;
+  int minorVersion = 1;
+  bool keepAlive = true;
+
+  std::string_view header(std::string_view name) const;
+
+  static ParseResult parse(std::string_view buffer, HttpRequest& request, size_t& consumed);
+
+  static constexpr size_t maxHeaderSize = 64 * 1024;
+  static constexpr size_t maxBodySize = 1024 * 1024;
+};
+
+struct HttpResponse {
+  int status = 200;
+  std::string contentType = "text/html; charset=utf-8";
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  // Set instead of body when the bytes already live elsewhere, such as in the render cache.
+  std::shared_ptr<const std::string> sharedBody;
+  std::shared_ptr<const ResponseFile> bodyFile;
+  bool keepAlive = true;
+  bool chunked = false;
+  // The head and the body so far were already written by the server, which sends the rest as it becomes ready.
+  bool streaming = false;
+
+  size_t contentLength() const;
+  void serializeHead(std::string& output) const;
+  void serialize(std::string& output) const;
+  void write(ResponseWriter& writer, bool includeBody = true);
+
+  static std::string_view reason(int status);
+  static void chunk(std::string_view data, std::string& output);
+  static void lastChunk(std::string& output);
+};
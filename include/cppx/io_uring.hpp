@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+// A minimal io_uring over the raw system calls: one submission and completion ring plus one provided buffer group.
+class IoUring {
+ public:
+  // Throws std::system_error when the kernel lacks io_uring or the features used here.
+  IoUring(unsigned entries, unsigned bufferCount, unsigned bufferSize);
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  static constexpr uint16_t bufferGroup = 0;
+
+  // Returns a zeroed entry, submitting the queued ones first if the ring is full.
+  io_uring_sqe* prepare(uint8_t opcode, int fd, uint64_t data);
+  // Submits everything queued and, when wait is set, blocks until at least one completion is available.
+  int submit(bool wait = false);
+  bool pending() const { return queued_ > 0; }
+
+  const io_uring_cqe* peek() const;
+  void advance();
+
+  char* buffer(uint16_t id) const { return buffers_ + static_cast<size_t>(id) * bufferSize_; }
+  void recycle(uint16_t id);
+
+ private:
+  int fd_ = -1;
+  unsigned queued_ = 0;
+
+  void* sqRing_ = nullptr;
+  size_t sqRingSize_ = 0;
+  void* cqRing_ = nullptr;
+  size_t cqRingSize_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqesSize_ = 0;
+
+  unsigned* sqHead_ = nullptr;
+  unsigned* sqTail_ = nullptr;
+  unsigned sqMask_ = 0;
+  unsigned sqEntries_ = 0;
+  unsigned* sqArray_ = nullptr;
+  unsigned* cqHead_ = nullptr;
+  unsigned* cqTail_ = nullptr;
+  unsigned cqMask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  io_uring_buf_ring* bufferRing_ = nullptr;
+  size_t bufferRingSize_ = 0;
+  char* buffers_ = nullptr;
+  unsigned bufferCount_ = 0;
+  unsigned bufferSize_ = 0;
+  uint16_t bufferTail_ = 0;
+
+  void release();
+};
@@ -1,14 +1,13 @@
 #pragma once
 
-#include <algorithm>
-#include <cctype>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <iosfwd>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -34,6 +33,7 @@ class JSON {
   JSON(const String& value);
   JSON(String&& value);
   JSON(const char* value);
+  JSON(std::string_view value);
   JSON(const Array& value);
   JSON(Array&& value);
   JSON(const Object& value);
@@ -71,6 +71,9 @@ class JSON {
   template <typename T>
   const T& value() const;
 
+  // Strings, arrays and objects built on this thread so far, for the per-route metrics; always 0 with CPPX_NO_TRACE.
+  static uint64_t valuesBuilt();
+
  private:
   Type type_;
   std::variant<Null, Boolean, Integer, Floating, String, Array, Object, Callable> value_;
@@ -1,6 +1,31 @@
 #pragma once
 
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "cppx/async.hpp"
 #include "cppx/json.hpp"
 
 using Page = JSON;
 using PageFunction = Page (*)();
+// Pages that await I/O are coroutines; the builder exports them as getAsyncPageFunction.
+using AsyncPage = Task<Page>;
+using AsyncPageFunction = AsyncPage (*)();
+using CacheKeyFunction = std::string (*)();
+
+std::string_view routeParam(std::string_view name);
+
+// Render caching is opt-in: a page that calls none of these is rendered again on every request. A page opts in while it
+// renders, by calling cacheable() when its output depends on nothing but its route, cacheKey when it also depends on
+// what the function returns, or cacheFor when it may be served for that long. Renders with callables or deferred
+// content, and those that call uncacheable(), are never cached, whatever else the page declared.
+void cacheable();
+void cacheKey(CacheKeyFunction function);
+void cacheFor(std::chrono::milliseconds timeToLive);
+void uncacheable();
+void invalidateCache(std::string_view route = {});
+
+// Renders fallback in place of content until content resolves. Served pages stream it in later over the same response;
+// pages with callables, and renders that cannot stream, wait for it instead.
+Page deferred(Task<Page> content, Page fallback = Page());
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cppx/json.hpp"
+
+// Describes how to turn the DOM rendered from one page tree into the DOM of another.
+// Nodes are addressed by childNodes indices below document.documentElement. Identical trees yield an empty string.
+class Patch {
+ public:
+  using Callables = std::vector<const JSON::Callable*>;
+
+  static std::string diff(const JSON& before, const Callables& beforeCallables, const JSON& after, const Callables& afterCallables, uint32_t generation);
+
+ private:
+  using Ids = std::unordered_map<const JSON::Callable*, size_t>;
+
+  struct Item {
+    const std::string* tag = nullptr;
+    const JSON* element = nullptr;
+    std::string text;
+  };
+
+  struct Context {
+    Ids beforeIds;
+    Ids afterIds;
+    std::vector<size_t> path;
+    std::string ops;
+  };
+
+  static void flatten(const JSON& node, std::vector<Item>& items);
+  static void diffElement(const Item& before, const Item& after, Context& context, bool root = false);
+  static void attributes(const JSON& element, const Ids& ids, std::vector<std::pair<const std::string*, std::string>>& output);
+  static std::optional<std::string> attribute(const JSON& value, const Ids& ids);
+  static const JSON* children(const Item& item);
+
+  static void beginOp(Context& context, const char* op);
+  static void writeNode(const Item& item, const Ids& ids, std::string& output);
+  static void writeString(const std::string& text, std::string& output);
+};
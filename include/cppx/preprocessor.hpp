@@ -1,11 +1,6 @@
 #pragma once
 
-#include <algorithm>
-#include <cctype>
-#include <iostream>
-#include <regex>
-#include <sstream>
-#include <stack>
+#include <iosfwd>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -14,6 +9,9 @@
 class Preprocessor {
  public:
   static std::string Process(const std::string& input);
+  static std::string Process(const std::string& input, std::ostream& diagnostics);
+  static const std::string version;
+  static const std::string header;
 
  private:
   struct DOMNode {
@@ -25,12 +23,11 @@ class Preprocessor {
   };
 
   static std::string AddHeader(const std::string& script);
-  static std::vector<std::string> ExtractValidHtmlBlocks(const std::string& script);
-  static DOMNode ParseHTML(const std::string& html, size_t& pos);
+  static std::vector<std::string> ExtractValidHtmlBlocks(const std::string& script, std::ostream& diagnostics);
+  static DOMNode ParseHTML(const std::string& html, size_t& pos, std::ostream& diagnostics);
   static std::string GenerateJSON(const DOMNode& node, int indent = 0);
   static std::string CorrectIndentation(const std::string& code);
   static std::string Trim(const std::string& str);
   static std::unordered_map<std::string, std::string> ParseAttributes(const std::string& attrString);
   static const std::unordered_set<std::string> htmlTags;
-  static const std::string header;
 };
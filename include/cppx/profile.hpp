@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+struct rusage;
+
+// Wall time, CPU time and peak memory of every build step, from the builder's own work and from the commands it runs.
+// Compiler commands report their parse, instantiation and code generation times and the headers they include, and the
+// whole build exports as one Chrome trace-event file. Nothing is recorded until enabled.
+class Profile {
+ public:
+  // Times in-process work on the calling thread. kind must be a string literal.
+  class Step {
+   public:
+    Step(const char* kind, std::string_view name);
+    ~Step();
+
+    Step(const Step&) = delete;
+    Step& operator=(const Step&) = delete;
+
+   private:
+    const char* kind_;
+    std::string name_;
+    uint64_t start_ = 0;
+    uint64_t cpu_ = 0;
+  };
+
+  static void enable() { enabled_.store(true, std::memory_order_relaxed); }
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Asks a compiler command for its timing report and include list.
+  static std::string instrument(const std::string& command);
+  // Records a finished command and takes what instrument asked for out of its output. usage is null where the platform
+  // cannot report what a command used.
+  static void command(const std::string& command, size_t worker, uint64_t start, uint64_t end, const struct rusage* usage, std::string& output);
+
+  static bool write(const std::filesystem::path& path);
+  static void summarize(std::ostream& output);
+  static void clear();
+
+  static uint64_t now() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+  static constexpr size_t summaryLength = 10;
+
+ private:
+  static inline std::atomic<bool> enabled_{false};
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cppx/render_cache.hpp"
+#include "cppx/router.hpp"
+
+// Resumes suspended async pages when their timers expire, descriptors become ready or offloaded work finishes.
+// fd() turns readable whenever dispatch() has something to resume, so the server polls it with its own sockets.
+class Reactor {
+ public:
+  Reactor();
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  int fd() const { return epollFd_; }
+
+  void sleep(std::chrono::steady_clock::duration duration, std::coroutine_handle<> handle);
+  void wait(int fd, uint32_t events, std::coroutine_handle<> handle);
+  void offload(std::function<void()> work, std::coroutine_handle<> handle);
+  void dispatch();
+
+  static Reactor* active();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // A page resumes with the route and cache recorder it suspended with, wherever it resumes.
+  struct Waiter {
+    std::coroutine_handle<> handle;
+    const Router::Match* match = nullptr;
+    RenderCache::Recorder* recorder = nullptr;
+  };
+
+  int epollFd_ = -1;
+  int timerFd_ = -1;
+  int readyFd_ = -1;
+
+  std::mutex mutex_;
+  std::multimap<Clock::time_point, Waiter> timers_;
+  std::vector<Waiter> ready_;
+
+  std::condition_variable jobsChanged_;
+  std::deque<std::pair<std::function<void()>, Waiter>> jobs_;
+  bool stopping_ = false;
+  std::thread blocking_;
+
+  static Waiter capture(std::coroutine_handle<> handle);
+  static void resume(const Waiter& waiter);
+  void dispatch(void* data);
+  void arm(Clock::time_point deadline);
+};
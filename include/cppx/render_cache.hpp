@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppx/compression.hpp"
+#include "cppx/page.hpp"
+#include "cppx/response_writer.hpp"
+
+class RenderCache {
+ public:
+  // Collects what the page declares about caching, and the subtrees it deferred, while it renders.
+  struct Recorder {
+    CacheKeyFunction keyFunction = nullptr;
+    std::chrono::milliseconds timeToLive{0};
+    // Set when the page declares how its render may be cached; dynamic, set by uncacheable() and deferred content,
+    // overrides it.
+    bool cacheable = false;
+    bool dynamic = false;
+    std::vector<Task<Page>> deferred;
+
+    bool caches() const { return cacheable && !dynamic; }
+
+    static Recorder* current();
+
+    // Makes a recorder current on this thread; async pages reinstall theirs wherever they resume.
+    class Scope {
+     public:
+      explicit Scope(Recorder* recorder);
+      ~Scope();
+
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+
+     private:
+      Recorder* previous_;
+    };
+  };
+
+  struct Body {
+    std::shared_ptr<const std::string> data;
+    // Static pages large enough to benefit are also kept in a file for sendfile.
+    std::shared_ptr<const ResponseFile> file;
+
+    explicit operator bool() const { return data != nullptr; }
+  };
+
+  RenderCache();
+  ~RenderCache();
+
+  RenderCache(const RenderCache&) = delete;
+  RenderCache& operator=(const RenderCache&) = delete;
+
+  Body find(std::string_view route, Compression::Encoding encoding = Compression::Encoding::Identity) const;
+  Body store(std::string_view route, const Recorder& recorder, std::string body, Compression::Encoding encoding = Compression::Encoding::Identity);
+  void invalidate(std::string_view route);
+  void clear();
+
+  static RenderCache* active();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t shardCount = 64;
+  static constexpr size_t minFileSize = 16 * 1024;
+  // Each shard holds at most its share of these, evicting expired entries first and then the least recently used.
+  static constexpr size_t maxEntries = 4096;
+  static constexpr size_t maxBytes = 256 * 1024 * 1024;
+  static constexpr size_t slotCount = 2 * maxEntries / shardCount;
+
+  struct Entry {
+    std::string key;
+    size_t hash = 0;
+    size_t bytes = 0;
+    std::array<Body, Compression::encodingCount> bodies;
+    CacheKeyFunction keyFunction = nullptr;
+    Clock::time_point expires = Clock::time_point::max();
+    mutable std::atomic<Clock::rep> used{0};
+  };
+
+  struct Hash {
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>()(key); }
+  };
+
+  // An open-addressed table of immutable entries. Readers never lock; writers replace or remove single slots under the
+  // mutex and retire what they took out through Epoch.
+  struct alignas(64) Shard {
+    std::array<std::atomic<const Entry*>, slotCount> slots{};
+    std::mutex mutex;
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
+
+  std::array<Shard, shardCount> shards_;
+  // Marks a removed slot so that lookups keep probing past it.
+  const Entry removed_;
+
+  Shard& shard(std::string_view route);
+  const Shard& shard(std::string_view route) const;
+  const Entry* lookup(const Shard& shard, std::string_view key) const;
+  void place(Shard& shard, const Entry* entry, std::vector<const Entry*>& retired);
+  void remove(Shard& shard, size_t slot, std::vector<const Entry*>& retired);
+  void evict(Shard& shard, std::vector<const Entry*>& retired);
+  static void retire(std::vector<const Entry*> retired);
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+struct iovec;
+
+// An unlinked temporary file holding a precomputed body, so it can be sent straight from the page cache.
+class ResponseFile {
+ public:
+  ~ResponseFile();
+
+  ResponseFile(const ResponseFile&) = delete;
+  ResponseFile& operator=(const ResponseFile&) = delete;
+
+  static std::shared_ptr<const ResponseFile> create(std::string_view content);
+
+  int fd() const;
+  size_t size() const { return size_; }
+
+ private:
+  ResponseFile(std::FILE* file, size_t size) : file_(file), size_(size) {}
+
+  std::FILE* file_;
+  size_t size_;
+};
+
+// Queues output as slices so bodies are written from where they already live instead of being copied together.
+class ResponseWriter {
+ public:
+  enum class Result { Complete, Blocked, Failed };
+
+  void append(std::string data);
+  // The view must stay valid while queued: string literals, or memory kept alive by the owner.
+  void appendView(std::string_view data, std::shared_ptr<const void> owner = nullptr);
+  void appendFile(std::shared_ptr<const ResponseFile> file);
+  void append(ResponseWriter&& other);
+
+  bool empty() const { return slices_.empty(); }
+  size_t size() const { return size_; }
+
+  Result flush(int fd);
+  void clear();
+
+  static constexpr int maxVectors = 64;
+
+  // For writers whose sends complete elsewhere: describe the leading in-memory slices, then drop what was sent.
+  // Queued slices never move, so gathered vectors stay valid while more output is appended.
+  int gather(iovec* vectors, int count) const;
+  void consume(size_t bytes);
+
+ private:
+  struct Slice {
+    std::string owned;
+    std::string_view view;
+    std::shared_ptr<const void> owner;
+    std::shared_ptr<const ResponseFile> file;
+
+    std::string_view data() const { return view.data() ? view : std::string_view(owned); }
+    size_t size() const { return file ? file->size() : data().size(); }
+  };
+
+  std::deque<Slice> slices_;
+  size_t offset_ = 0;
+  size_t size_ = 0;
+};
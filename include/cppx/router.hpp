@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cppx/page.hpp"
+
+class Router {
+ public:
+  static constexpr size_t maxParams = 8;
+
+  struct Match {
+    PageFunction page = nullptr;
+    AsyncPageFunction asyncPage = nullptr;
+    // The route as added, such as /blog/[id].
+    std::string_view route;
+    std::array<std::pair<std::string_view, std::string_view>, maxParams> params;
+    size_t paramCount = 0;
+    const std::shared_ptr<const void>* library = nullptr;
+
+    std::string_view param(std::string_view name) const;
+  };
+
+  class Scope {
+   public:
+    explicit Scope(const Match& match);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const Match* previous_;
+  };
+
+  Router();
+  ~Router();
+
+  Router(const Router&) = delete;
+  Router& operator=(const Router&) = delete;
+
+  // Returns false, adding nothing, when the route names a dynamic segment differently from a route already added, such as
+  // /blog/[slug] after /blog/[id].
+  bool add(std::string_view route, PageFunction page, std::shared_ptr<const void> library = nullptr);
+  bool add(std::string_view route, AsyncPageFunction page, std::shared_ptr<const void> library = nullptr);
+  size_t scan(const std::filesystem::path& directory, const Router* previous = nullptr);
+  bool match(std::string_view path, Match& match) const;
+
+  static const Match* current();
+
+ private:
+  struct Node {
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> children;
+    std::unique_ptr<Node> dynamic;
+    std::string paramName;
+    std::string route;
+    PageFunction page = nullptr;
+    AsyncPageFunction asyncPage = nullptr;
+    std::shared_ptr<const void> library;
+  };
+
+  struct Library {
+    std::filesystem::path source;
+    std::filesystem::file_time_type modified;
+    uintmax_t size = 0;
+    void* handle = nullptr;
+    PageFunction page = nullptr;
+    AsyncPageFunction asyncPage = nullptr;
+
+    ~Library();
+  };
+
+  std::unique_ptr<Node> root_;
+  std::vector<std::shared_ptr<Library>> libraries_;
+
+  Node* insert(std::string_view route);
+
+  static std::shared_ptr<Library> load(const std::filesystem::path& source);
+
+  static bool matchNode(const Node& node, std::string_view path, Match& match);
+  static std::string_view nextSegment(std::string_view& path);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct rusage;
+
+class Scheduler {
+ public:
+  using JobId = size_t;
+
+  explicit Scheduler(size_t jobs = defaultJobs());
+
+  JobId add(const std::string& command, const std::string& errorMessage, const std::vector<JobId>& dependencies = {}, std::function<bool()> upToDate = nullptr, std::function<void()> onSuccess = nullptr);
+  bool run();
+
+  static size_t defaultJobs();
+  static size_t parseJobs(int argc, char* argv[]);
+
+ private:
+  enum class State { Waiting, Ready, Running, Succeeded, Failed, Skipped };
+
+  struct Job {
+    std::string command;
+    std::string errorMessage;
+    std::function<bool()> upToDate;
+    std::function<void()> onSuccess;
+    std::vector<JobId> dependents;
+    size_t pendingDependencies = 0;
+    State state = State::Waiting;
+  };
+
+  size_t jobs_;
+  std::vector<Job> queue_;
+  std::deque<JobId> ready_;
+  size_t unfinished_ = 0;
+  bool failed_ = false;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+
+  void worker(size_t index);
+  void finish(JobId id, bool succeeded, const std::string& output);
+  void skip(JobId id);
+  static int execute(const std::string& command, std::string& output, struct rusage* usage = nullptr);
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cppx/compression.hpp"
+#include "cppx/http.hpp"
+#include "cppx/io_uring.hpp"
+#include "cppx/page.hpp"
+#include "cppx/reactor.hpp"
+#include "cppx/render_cache.hpp"
+#include "cppx/response_writer.hpp"
+#include "cppx/router.hpp"
+#include "cppx/session.hpp"
+#include "cppx/thread_pool.hpp"
+#include "cppx/watcher.hpp"
+
+struct ServerOptions {
+  std::string host = "0.0.0.0";
+  uint16_t port = 8080;
+  std::filesystem::path routerDirectory;
+  bool hotReload = true;
+  size_t threads = ThreadPool::defaultThreads();
+  bool pinThreads = false;
+  std::chrono::milliseconds frameWindow{16};
+  int compressionLevel = 6;
+  bool renderCache = true;
+  bool ioUring = false;
+  // Live sessions kept per process; the least recently used is dropped to make room.
+  size_t maxSessions = 10000;
+  // With workers, a supervisor forks that many server processes sharing the port.
+  size_t workers = 0;
+  // Spans are written here as a Chrome trace when the server stops; metrics are served at /_cppx/metrics.
+  std::filesystem::path traceFile;
+  bool metrics = false;
+  std::vector<std::pair<std::string, PageFunction>> routes;
+  std::vector<std::pair<std::string, AsyncPageFunction>> asyncRoutes;
+
+  static ServerOptions parse(int argc, char* argv[]);
+};
+
+class Server {
+ public:
+  explicit Server(ServerOptions options);
+  ~Server();
+
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  int run();
+  void stop();
+  void reload();
+
+  void handle(const HttpRequest& request, HttpResponse& response);
+
+ private:
+  static constexpr size_t maxPipelined = 64;
+  // Beyond this a connection is sending requests faster than it reads responses, and is closed.
+  static constexpr size_t maxBufferedInput = maxPipelined * (HttpRequest::maxHeaderSize + HttpRequest::maxBodySize);
+  static constexpr size_t maxLiveBacklog = 256 * 1024;
+  static constexpr size_t minCompressedSize = 256;
+  static constexpr size_t compressedChunkSize = 16 * 1024;
+  static constexpr std::string_view callPrefix = "/_cppx/call/";
+  static constexpr std::string_view livePath = "/_cppx/live";
+  static constexpr std::string_view eventsPath = "/_cppx/events";
+  static constexpr std::string_view metricsPath = "/_cppx/metrics";
+  static constexpr unsigned ringEntries = 1024;
+  static constexpr unsigned receiveBufferCount = 1024;
+  static constexpr unsigned receiveBufferSize = 8 * 1024;
+  static constexpr std::chrono::seconds drainTimeout{5};
+
+  // The low bits of an io_uring completion's user data say which operation finished.
+  enum class Operation : uint64_t { Accept, Poll, Receive, Send, Writable };
+
+  enum class Protocol { Http, WebSocket, EventStream };
+
+  struct Exchange {
+    std::string request;
+    HttpRequest parsed;
+    HttpResponse response;
+    ResponseWriter output;
+    bool keepAlive = true;
+    std::atomic<bool> done{false};
+    // A streamed response is sent as its chunks arrive; output is shared with the renders appending them.
+    std::atomic<bool> streaming{false};
+    std::mutex mutex;
+  };
+
+  // Takes the next piece of a streamed response; the last one ends it.
+  using Sink = std::function<void(std::string output, bool last)>;
+
+  // A sendmsg handed to io_uring; the kernel reads its vectors until the completion arrives.
+  struct Transfer {
+    int fd = -1;
+    uint64_t id = 0;
+    bool active = false;
+    msghdr message{};
+    iovec vectors[ResponseWriter::maxVectors];
+    ResponseWriter orphaned;
+  };
+
+  // An async page in flight. It outlives the request's hold on the routing table, so it owns what its match points to.
+  struct AsyncRender {
+    Router::Match match;
+    std::string route;
+    std::array<std::pair<std::string, std::string>, Router::maxParams> params;
+    std::shared_ptr<const void> library;
+    RenderCache::Recorder recorder;
+    std::optional<AsyncPage> task;
+  };
+
+  struct Connection {
+    uint64_t id = 0;
+    std::string input;
+    ResponseWriter output;
+    std::unique_ptr<Transfer> transfer;
+    std::deque<std::shared_ptr<Exchange>> pending;
+    Protocol protocol = Protocol::Http;
+    std::shared_ptr<Sessions::Session> live;
+    bool lastRequest = false;
+    bool peerClosed = false;
+    bool closeAfterWrite = false;
+    bool writing = false;
+    // Reading stops while the pipeline is full, so the socket buffer pushes back on the client.
+    bool paused = false;
+  };
+
+  ServerOptions options_;
+  int epollFd_ = -1;
+  int listenFd_ = -1;
+  int signalFd_ = -1;
+  int stopFd_ = -1;
+  int wakeFd_ = -1;
+  int timerFd_ = -1;
+  bool timerArmed_ = false;
+  bool draining_ = false;
+  std::chrono::steady_clock::time_point drainDeadline_;
+  uint64_t lastConnectionId_ = 0;
+  std::unordered_map<int, Connection> connections_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::unique_ptr<IoUring> ring_;
+  std::unique_ptr<Reactor> reactor_;
+  std::vector<std::unique_ptr<Transfer>> orphans_;
+  std::mutex completedMutex_;
+  std::vector<std::pair<int, uint64_t>> completed_;
+  std::vector<std::function<void()>> posted_;
+  Sessions sessions_;
+  RenderCache cache_;
+  std::unordered_set<std::shared_ptr<Sessions::Session>> dirty_;
+  std::unordered_map<const Sessions::Session*, std::vector<std::pair<int, uint64_t>>> subscribers_;
+  std::atomic<const Router*> router_{nullptr};
+  std::unique_ptr<Watcher> watcher_;
+  std::thread reloader_;
+
+  bool listen();
+  int serve();
+  int serveEpoll();
+  bool drain();
+  bool settled() const;
+  int serveRing();
+  void accept();
+  void admit(int fd);
+  void read(int fd, Connection& connection);
+  void arm(Operation operation, int fd, uint64_t id = 0);
+  void received(const io_uring_cqe& completion);
+  void sent(const io_uring_cqe& completion);
+  bool submit(int fd, Connection& connection);
+  void process(int fd, Connection& connection);
+  bool respond(const std::shared_ptr<Exchange>& exchange, int fd, uint64_t id);
+  void reply(Exchange& exchange);
+  void complete(int fd, uint64_t id);
+  void post(std::function<void()> task);
+  void collect();
+  void queue(Connection& connection, std::string output, bool keepAlive = true);
+  void advance(int fd, Connection& connection);
+  void flush(int fd, Connection& connection);
+  void update(int fd, const Connection& connection);
+  bool handle(const HttpRequest& request, HttpResponse& response, std::function<void()> finished, Sink sink = nullptr);
+  bool present(const HttpRequest& request, HttpResponse& response, const Router::Match& match, Page page, RenderCache::Recorder& recorder, Compression::Encoding encoding,
+               const std::function<void()>& finished, const Sink& sink);
+  void render(const HttpRequest& request, HttpResponse& response, const Router::Match& match, Page page, const RenderCache::Recorder& recorder, Compression::Encoding encoding);
+  void defer(const Router::Match& match, AsyncPage task, std::function<void(AsyncRender&)> finish);
+  void resolve(const Router::Match& match, Page page, std::vector<AsyncPage> deferred, std::function<void(const Router::Match&, Page)> finish);
+  void stream(HttpResponse& response, const Router::Match& match, const Page& page, std::vector<AsyncPage> deferred, Compression::Encoding encoding, Sink sink);
+  void encode(HttpResponse& response, Compression::Encoding encoding);
+  void compress(const HttpRequest& request, HttpResponse& response, Compression::Encoding encoding);
+  void attach(const HttpRequest& request, HttpResponse& response, const Router::Match& match, Page page, std::vector<const JSON::Callable*> callables);
+  void invoke(const HttpRequest& request, HttpResponse& response);
+  void upgrade(int fd, const HttpRequest& request, Connection& connection, Exchange& exchange);
+  void receive(Connection& connection);
+  void publish();
+  void refresh(const std::shared_ptr<Sessions::Session>& session);
+  void repaint(const std::shared_ptr<Sessions::Session>& session, const std::string& path, const Router::Match& match, Page page);
+  void deliver(const std::shared_ptr<Sessions::Session>& session, const std::string& message);
+  void close(int fd);
+};
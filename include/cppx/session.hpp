@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "cppx/page.hpp"
+
+class Sessions {
+ public:
+  // The callables of the page last rendered for a client, addressed by their position in the tree.
+  struct Session {
+    std::mutex mutex;
+    std::shared_ptr<const void> library;
+    Page page;
+    std::vector<const JSON::Callable*> callables;
+    std::string path;
+    uint32_t generation = 0;
+    std::chrono::steady_clock::time_point lastUsed;
+  };
+
+  static constexpr std::string_view cookieName = "cppx_session";
+  static constexpr std::chrono::minutes defaultTimeToLive{10};
+
+  // Sessions idle past timeToLive expire unless a live channel still holds them. Past capacity, the least recently used goes.
+  explicit Sessions(std::chrono::seconds timeToLive = defaultTimeToLive, size_t capacity = 10000);
+
+  std::shared_ptr<Session> find(std::string_view id);
+  std::shared_ptr<Session> create(std::string& id);
+  size_t sweep();
+
+  static std::string_view cookie(std::string_view header);
+
+ private:
+  static constexpr size_t shardCount = 16;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+    std::chrono::steady_clock::time_point lastSweep;
+  };
+
+  std::chrono::seconds timeToLive_;
+  size_t shardCapacity_;
+  std::array<Shard, shardCount> shards_;
+
+  Shard& shard(std::string_view id);
+  void sweep(Shard& shard, std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<Session>>& expired);
+  void evict(Shard& shard, std::vector<std::shared_ptr<Session>>& expired);
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+// Runs work in a fixed number of forked worker processes. Everything prepare loads before a fork, such as the route
+// table and its page libraries, is shared copy-on-write. A worker that dies is replaced, SIGHUP replaces them all one
+// at a time, and SIGINT or SIGTERM stops them; a second one kills them.
+class Supervisor {
+ public:
+  Supervisor(size_t workers, std::function<void()> prepare, std::function<int()> work);
+  ~Supervisor();
+
+  Supervisor(const Supervisor&) = delete;
+  Supervisor& operator=(const Supervisor&) = delete;
+
+  int run();
+
+  // Workers that die sooner than this are restarted after restartDelay, and end the supervisor if they exit with an error.
+  static constexpr std::chrono::seconds minUptime{1};
+  static constexpr std::chrono::seconds restartDelay{1};
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Worker {
+    pid_t pid = -1;
+    Clock::time_point started;
+    std::optional<Clock::time_point> restartAt;
+  };
+
+  std::function<void()> prepare_;
+  std::function<int()> work_;
+  std::vector<Worker> workers_;
+  std::unordered_set<pid_t> retiring_;
+  std::deque<size_t> rolling_;
+  int signalFd_ = -1;
+  sigset_t mask_{};
+  bool stopping_ = false;
+  int status_ = 0;
+
+  void spawn(size_t slot);
+  void reap();
+  void roll();
+  void signal(int number);
+  size_t running() const;
+};
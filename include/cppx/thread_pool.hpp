@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(size_t threads = defaultThreads(), bool pin = false);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void submit(Task task);
+  size_t size() const { return threads_.size(); }
+
+  static size_t defaultThreads();
+
+ private:
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> sleeping_{0};
+  bool stopping_ = false;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+
+  void work(size_t index, bool pin);
+  bool take(size_t index, Task& task);
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Spans, counters and per-route histograms, kept in per-thread buffers that only their own thread writes. Spans export
+// as a Chrome trace-event file and the rest as Prometheus text. Recording is off until enabled at run time, and
+// building with CPPX_NO_TRACE defined compiles every recording call away.
+class Trace {
+ public:
+  enum class Counter { Requests, CacheHits, Reloads, BytesSent };
+  static constexpr size_t counterCount = 4;
+
+  // Times the enclosing scope. name must be a string literal; detail is copied only when the span is recorded.
+  class Span {
+   public:
+#if defined(CPPX_NO_TRACE)
+    explicit Span(const char*, std::string_view = {}) {}
+#else
+    explicit Span(const char* name, std::string_view detail = {}) : name_(name), detail_(detail), start_(spans_.load(std::memory_order_relaxed) ? now() : 0) {}
+    ~Span() {
+      if (start_) record(name_, detail_, start_, now());
+    }
+#endif
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+#if !defined(CPPX_NO_TRACE)
+   private:
+    const char* name_;
+    std::string_view detail_;
+    uint64_t start_;
+#endif
+  };
+
+  // One render of a route, added to its histograms when it ends. Code further down fills in what it produced.
+  class Sample {
+   public:
+#if defined(CPPX_NO_TRACE)
+    explicit Sample(std::string_view) {}
+    static Sample* current() { return nullptr; }
+#else
+    explicit Sample(std::string_view route);
+    ~Sample();
+    static Sample* current();
+#endif
+
+    Sample(const Sample&) = delete;
+    Sample& operator=(const Sample&) = delete;
+
+    size_t bytes = 0;
+    uint64_t jsonValues = 0;
+
+#if !defined(CPPX_NO_TRACE)
+   private:
+    std::string_view route_;
+    uint64_t start_ = 0;
+    Sample* previous_ = nullptr;
+#endif
+  };
+
+#if defined(CPPX_NO_TRACE)
+  static void enableSpans() {}
+  static void enableMetrics() {}
+  static void count(Counter, uint64_t = 1) {}
+#else
+  static void enableSpans() { spans_.store(true, std::memory_order_relaxed); }
+  static void enableMetrics() { metrics_.store(true, std::memory_order_relaxed); }
+  static void count(Counter counter, uint64_t value = 1) {
+    if (metrics_.load(std::memory_order_relaxed)) add(counter, value);
+  }
+#endif
+
+  // Exports what the threads recorded. Spans are read without synchronization, so write them once those threads have stopped.
+  static bool write(const std::filesystem::path& path);
+  static std::string prometheus();
+
+  static constexpr size_t eventCapacity = 16 * 1024;
+
+ private:
+  static inline std::atomic<bool> spans_{false};
+  static inline std::atomic<bool> metrics_{false};
+
+  static uint64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+  static void record(const char* name, std::string_view detail, uint64_t start, uint64_t end);
+  static void add(Counter counter, uint64_t value);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class Watcher {
+ public:
+  explicit Watcher(const std::vector<std::filesystem::path>& directories, std::chrono::milliseconds debounce = std::chrono::milliseconds(50));
+  ~Watcher();
+
+  Watcher(const Watcher&) = delete;
+  Watcher& operator=(const Watcher&) = delete;
+
+  std::vector<std::filesystem::path> wait();
+  void interrupt();
+  // True when the last wait() lost events, so its changes are incomplete and callers should treat everything as changed.
+  bool overflowed() const { return overflowed_; }
+
+ private:
+  std::vector<std::filesystem::path> directories_;
+  std::chrono::milliseconds debounce_;
+  int fd_ = -1;
+  int interruptFd_ = -1;
+  std::atomic<bool> interrupted_{false};
+  bool overflowed_ = false;
+  std::unordered_map<int, std::filesystem::path> watches_;
+  std::unordered_map<std::string, std::filesystem::file_time_type> snapshot_;
+
+  void addWatch(const std::filesystem::path& directory, std::set<std::filesystem::path>* created);
+  bool readEvents(int timeout, std::set<std::filesystem::path>& changed);
+  bool pollSnapshot(std::set<std::filesystem::path>& changed);
+};
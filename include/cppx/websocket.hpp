@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class WebSocket {
+ public:
+  enum class Opcode : uint8_t { Continuation = 0, Text = 1, Binary = 2, Close = 8, Ping = 9, Pong = 10 };
+  enum class ParseResult { Complete, Incomplete, Invalid };
+
+  struct Frame {
+    Opcode opcode = Opcode::Text;
+    bool final = true;
+    std::string payload;
+  };
+
+  static std::string acceptKey(std::string_view key);
+  static void frame(Opcode opcode, std::string_view payload, std::string& output);
+  static ParseResult parse(std::string_view buffer, Frame& frame, size_t& consumed);
+
+  static constexpr size_t maxPayloadSize = 64 * 1024;
+
+ private:
+  static std::string sha1(std::string_view input);
+  static std::string base64(std::string_view input);
+};
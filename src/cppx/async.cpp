@@ -0,0 +1,148 @@
+#include "cppx/async.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <thread>
+
+#include "cppx/reactor.hpp"
+
+namespace {
+
+class Descriptor {
+ public:
+  explicit Descriptor(int fd) : fd_(fd) {}
+  ~Descriptor() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  Descriptor(const Descriptor&) = delete;
+  Descriptor& operator=(const Descriptor&) = delete;
+
+  int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+[[noreturn]] void fail(const std::string& what) { throw std::system_error(errno, std::generic_category(), what); }
+
+}  // namespace
+
+bool Sleep::await_ready() {
+  if (duration_.count() <= 0) {
+    return true;
+  }
+  if (!Reactor::active()) {
+    std::this_thread::sleep_for(duration_);
+    return true;
+  }
+  return false;
+}
+
+void Sleep::await_suspend(std::coroutine_handle<> handle) { Reactor::active()->sleep(duration_, handle); }
+
+bool Readiness::await_ready() {
+  if (!Reactor::active()) {
+    pollfd descriptor{fd_, static_cast<short>(events_), 0};
+    while (::poll(&descriptor, 1, -1) < 0 && errno == EINTR) {
+    }
+    return true;
+  }
+  return false;
+}
+
+void Readiness::await_suspend(std::coroutine_handle<> handle) { Reactor::active()->wait(fd_, events_, handle); }
+
+bool Offload::await_ready() {
+  if (!Reactor::active()) {
+    work_();
+    return true;
+  }
+  return false;
+}
+
+void Offload::await_suspend(std::coroutine_handle<> handle) { Reactor::active()->offload(std::move(work_), handle); }
+
+Sleep sleepFor(std::chrono::steady_clock::duration duration) { return Sleep(duration); }
+
+Readiness readable(int fd) { return Readiness(fd, POLLIN); }
+
+Readiness writable(int fd) { return Readiness(fd, POLLOUT); }
+
+Task<std::string> readFile(std::filesystem::path path) {
+  std::string content;
+  bool found = false;
+  co_await Offload([&] {
+    std::ifstream file(path, std::ios::binary);
+    if (file) {
+      found = true;
+      content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+  });
+
+  if (!found) {
+    throw std::runtime_error("Cannot read " + path.string());
+  }
+  co_return content;
+}
+
+Task<std::string> querySocket(std::filesystem::path socket, std::string request) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket.native().size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Socket path too long: " + socket.string());
+  }
+  std::memcpy(address.sun_path, socket.c_str(), socket.native().size());
+
+  Descriptor descriptor(::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+  int fd = descriptor.get();
+  if (fd < 0) {
+    fail("Cannot create socket");
+  }
+
+  // A full listen backlog makes a non-blocking Unix connect fail with EAGAIN rather than wait.
+  while (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    if (errno == EAGAIN) {
+      co_await sleepFor(std::chrono::milliseconds(1));
+    } else if (errno != EINTR) {
+      fail("Cannot connect to " + socket.string());
+    }
+  }
+
+  for (size_t offset = 0; offset < request.size();) {
+    ssize_t sent = send(fd, request.data() + offset, request.size() - offset, MSG_NOSIGNAL);
+    if (sent >= 0) {
+      offset += static_cast<size_t>(sent);
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      co_await writable(fd);
+    } else if (errno != EINTR) {
+      fail("Cannot write to " + socket.string());
+    }
+  }
+  shutdown(fd, SHUT_WR);
+
+  std::string response;
+  char buffer[16 * 1024];
+  while (true) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+      response.append(buffer, static_cast<size_t>(received));
+    } else if (received == 0) {
+      break;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      co_await readable(fd);
+    } else if (errno != EINTR) {
+      fail("Cannot read from " + socket.string());
+    }
+  }
+
+  co_return response;
+}
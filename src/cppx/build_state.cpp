@@ -0,0 +1,186 @@
+#include "cppx/build_state.hpp"
+
+#include <fstream>
+#include <sstream>
+
+#include "cppx/cache.hpp"
+
+namespace {
+
+// Stands in for the hash of an input that did not exist when the target was built.
+const std::string missingHash = "missing";
+
+std::string readAll(const std::filesystem::path& path) {
+  std::ifstream inputFile(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+BuildState::BuildState(const std::filesystem::path& directory) : directory_(directory) {}
+
+std::filesystem::path BuildState::recordPath(const std::filesystem::path& output) const {
+  return directory_ / (Cache::hash(output.lexically_normal().string()) + ".state");
+}
+
+bool BuildState::stat(const std::filesystem::path& path, Stamp& stamp) {
+  std::error_code error;
+  auto modified = std::filesystem::last_write_time(path, error);
+  if (error) return false;
+  auto size = std::filesystem::file_size(path, error);
+  if (error) return false;
+
+  stamp.path = path.lexically_normal().string();
+  stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+  stamp.size = size;
+  return true;
+}
+
+std::string BuildState::hash(const Stamp& stamp) const {
+  {
+    std::lock_guard<std::mutex> lock(hashesMutex_);
+    auto known = hashes_.find(stamp.path);
+    if (known != hashes_.end() && known->second.modified == stamp.modified && known->second.size == stamp.size) {
+      return known->second.hash;
+    }
+  }
+
+  // Hashed outside the lock so that other targets are not held up; two jobs may hash the same file once each.
+  Stamp hashed = stamp;
+  hashed.hash = Cache::hash(readAll(stamp.path));
+  std::lock_guard<std::mutex> lock(hashesMutex_);
+  hashes_[stamp.path] = hashed;
+  return hashed.hash;
+}
+
+std::vector<std::filesystem::path> BuildState::parseDependencyFile(const std::filesystem::path& dependencyFile) {
+  std::vector<std::filesystem::path> dependencies;
+  std::string content = readAll(dependencyFile);
+
+  size_t colon = content.find(": ");
+  if (colon == std::string::npos) {
+    return dependencies;
+  }
+
+  std::string current;
+  for (size_t i = colon + 1; i < content.size(); ++i) {
+    char c = content[i];
+    if (c == '\\' && i + 1 < content.size()) {
+      char next = content[i + 1];
+      if (next == '\n' || next == '\r') {
+        ++i;
+        continue;
+      }
+      if (next == ' ' || next == '#' || next == '\\') {
+        current += next;
+        ++i;
+        continue;
+      }
+    }
+    if (c == '$' && i + 1 < content.size() && content[i + 1] == '$') {
+      current += '$';
+      ++i;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      if (!current.empty()) {
+        dependencies.emplace_back(current);
+        current.clear();
+      }
+      // Anything after the first rule line belongs to -MP phony targets.
+      if (c == '\n' && !dependencies.empty() && i + 1 < content.size() && content[i + 1] != ' ') {
+        break;
+      }
+      continue;
+    }
+    current += c;
+  }
+
+  if (!current.empty()) {
+    dependencies.emplace_back(current);
+  }
+
+  return dependencies;
+}
+
+std::vector<std::filesystem::path> BuildState::collectInputs(const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile) {
+  std::vector<std::filesystem::path> allInputs = inputs;
+  if (!dependencyFile.empty()) {
+    for (const auto& dependency : parseDependencyFile(dependencyFile)) {
+      allInputs.push_back(dependency);
+    }
+  }
+  return allInputs;
+}
+
+bool BuildState::upToDate(const std::filesystem::path& output, const std::string& command, const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile) const {
+  if (!std::filesystem::exists(output)) {
+    return false;
+  }
+  if (!dependencyFile.empty() && !std::filesystem::exists(dependencyFile)) {
+    return false;
+  }
+
+  std::ifstream recordFile(recordPath(output));
+  if (!recordFile) {
+    return false;
+  }
+
+  std::string recordedCommand;
+  if (!std::getline(recordFile, recordedCommand) || recordedCommand != command) {
+    return false;
+  }
+
+  size_t recordedInputs = 0;
+  std::string line;
+  while (std::getline(recordFile, line)) {
+    std::istringstream iss(line);
+    Stamp recorded;
+    iss >> recorded.modified >> recorded.size >> recorded.hash;
+    iss.get();
+    std::getline(iss, recorded.path);
+
+    Stamp current;
+    if (recorded.hash == missingHash) {
+      if (stat(recorded.path, current)) {
+        return false;
+      }
+      recordedInputs++;
+      continue;
+    }
+    if (!stat(recorded.path, current)) {
+      return false;
+    }
+    if (current.modified != recorded.modified || current.size != recorded.size) {
+      if (current.size != recorded.size || hash(current) != recorded.hash) {
+        return false;
+      }
+    }
+    recordedInputs++;
+  }
+
+  return recordedInputs == collectInputs(inputs, dependencyFile).size();
+}
+
+void BuildState::record(const std::filesystem::path& output, const std::string& command, const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile) const {
+  std::ostringstream content;
+  content << command << "\n";
+
+  for (const auto& input : collectInputs(inputs, dependencyFile)) {
+    Stamp stamp;
+    if (!stat(input, stamp)) {
+      // Still recorded, so the input count matches and the target rebuilds once the input appears.
+      stamp.path = input.lexically_normal().string();
+      stamp.modified = -1;
+      stamp.hash = missingHash;
+    } else {
+      stamp.hash = hash(stamp);
+    }
+    content << stamp.modified << " " << stamp.size << " " << stamp.hash << " " << stamp.path << "\n";
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  std::ofstream recordFile(recordPath(output));
+  recordFile << content.str();
+}
@@ -0,0 +1,89 @@
+#include "cppx/cache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+Cache::Cache(const std::filesystem::path& directory) : directory_(directory) {}
+
+std::filesystem::path Cache::pathFor(const std::string& key) const {
+  return directory_ / key.substr(0, 2) / key;
+}
+
+std::optional<std::string> Cache::get(const std::string& key) const {
+  std::filesystem::path entryPath = pathFor(key);
+  std::ifstream inputFile(entryPath, std::ios::binary);
+  if (!inputFile) {
+    return std::nullopt;
+  }
+  // The write time doubles as the last use, which is what prune evicts by.
+  std::error_code error;
+  std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), error);
+  return std::string((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+}
+
+void Cache::put(const std::string& key, const std::string& content) const {
+  std::filesystem::path entryPath = pathFor(key);
+  std::error_code error;
+  std::filesystem::create_directories(entryPath.parent_path(), error);
+
+  // Entries are published with a rename so concurrent readers never observe a partial write.
+  std::ostringstream temporaryName;
+  temporaryName << key << ".tmp." << std::this_thread::get_id();
+  std::filesystem::path temporaryPath = entryPath.parent_path() / temporaryName.str();
+
+  {
+    std::ofstream outputFile(temporaryPath, std::ios::binary);
+    if (!outputFile) {
+      return;
+    }
+    outputFile << content;
+  }
+
+  std::filesystem::rename(temporaryPath, entryPath, error);
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+  }
+}
+
+void Cache::prune(uintmax_t maxBytes) const {
+  std::vector<std::tuple<std::filesystem::file_time_type, uintmax_t, std::filesystem::path>> entries;
+  uintmax_t total = 0;
+  std::error_code error;
+  for (auto it = std::filesystem::recursive_directory_iterator(directory_, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+    if (!it->is_regular_file(error)) continue;
+    uintmax_t size = it->file_size(error);
+    auto used = it->last_write_time(error);
+    if (error) continue;
+    entries.emplace_back(used, size, it->path());
+    total += size;
+  }
+  if (total <= maxBytes) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end());
+  for (const auto& [used, size, path] : entries) {
+    if (total <= maxBytes) break;
+    if (std::filesystem::remove(path, error)) total -= size;
+  }
+}
+
+std::string Cache::hash(const std::string& content) {
+  uint64_t high = 0xcbf29ce484222325ULL;
+  uint64_t low = 0x84222325cbf29ce4ULL;
+  for (unsigned char c : content) {
+    high = (high ^ c) * 0x100000001b3ULL;
+    low = (low ^ c) * 0x100000001b3ULL;
+    low ^= low >> 29;
+  }
+
+  std::ostringstream oss;
+  oss << std::hex << std::setfill('0') << std::setw(16) << high << std::setw(16) << low;
+  return oss.str();
+}
@@ -0,0 +1,117 @@
+#include "cppx/compression.hpp"
+
+#include <zlib.h>
+
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+
+// deflateInit allocates a few hundred kilobytes of state; each thread keeps its last stream for the next response.
+struct IdleStream {
+  std::unique_ptr<z_stream_s> stream;
+  int windowBits = 0;
+  int level = 0;
+
+  ~IdleStream() {
+    if (stream) deflateEnd(stream.get());
+  }
+};
+
+thread_local IdleStream idleStream;
+
+}  // namespace
+
+Compression::Stream::Stream(Encoding encoding, int level) : windowBits_(encoding == Encoding::Gzip ? 15 + 16 : 15), level_(level) {
+  if (idleStream.stream && idleStream.windowBits == windowBits_ && idleStream.level == level_) {
+    stream_ = std::move(idleStream.stream);
+    deflateReset(stream_.get());
+    return;
+  }
+
+  // Window bits above 15 select the gzip wrapper; HTTP's "deflate" is the zlib format.
+  stream_ = std::make_unique<z_stream_s>();
+  if (deflateInit2(stream_.get(), level_, Z_DEFLATED, windowBits_, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Cannot initialize zlib stream");
+  }
+}
+
+Compression::Stream::~Stream() {
+  if (idleStream.stream) {
+    deflateEnd(stream_.get());
+    return;
+  }
+  idleStream.stream = std::move(stream_);
+  idleStream.windowBits = windowBits_;
+  idleStream.level = level_;
+}
+
+void Compression::Stream::write(std::string_view input, std::string& output) { deflate(input, Z_NO_FLUSH, output); }
+
+void Compression::Stream::flush(std::string& output) { deflate({}, Z_SYNC_FLUSH, output); }
+
+void Compression::Stream::finish(std::string& output) { deflate({}, Z_FINISH, output); }
+
+void Compression::Stream::deflate(std::string_view input, int flush, std::string& output) {
+  stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream_->avail_in = static_cast<uInt>(input.size());
+
+  int result = Z_OK;
+  do {
+    size_t size = output.size();
+    size_t available = deflateBound(stream_.get(), stream_->avail_in) + 64;
+    output.resize(size + available);
+
+    stream_->next_out = reinterpret_cast<Bytef*>(output.data() + size);
+    stream_->avail_out = static_cast<uInt>(available);
+    result = ::deflate(stream_.get(), flush);
+
+    output.resize(size + available - stream_->avail_out);
+  } while (flush == Z_FINISH ? result == Z_OK : stream_->avail_out == 0);
+}
+
+Compression::Encoding Compression::negotiate(std::string_view acceptEncoding) {
+  bool gzip = false;
+  bool deflate = false;
+
+  while (!acceptEncoding.empty()) {
+    size_t comma = acceptEncoding.find(',');
+    std::string_view token = acceptEncoding.substr(0, comma);
+    acceptEncoding.remove_prefix(comma == std::string_view::npos ? acceptEncoding.size() : comma + 1);
+
+    size_t semicolon = token.find(';');
+    std::string_view coding = token.substr(0, semicolon);
+    while (!coding.empty() && coding.front() == ' ') coding.remove_prefix(1);
+    while (!coding.empty() && coding.back() == ' ') coding.remove_suffix(1);
+
+    bool accepted = true;
+    if (semicolon != std::string_view::npos) {
+      std::string_view parameter = token.substr(semicolon + 1);
+      size_t q = parameter.find("q=");
+      if (q != std::string_view::npos) {
+        accepted = std::strtod(std::string(parameter.substr(q + 2)).c_str(), nullptr) > 0;
+      }
+    }
+
+    if (coding == "gzip" || coding == "*") gzip = gzip || accepted;
+    if (coding == "deflate") deflate = deflate || accepted;
+  }
+
+  return gzip ? Encoding::Gzip : deflate ? Encoding::Deflate : Encoding::Identity;
+}
+
+std::string_view Compression::name(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::Gzip: return "gzip";
+    case Encoding::Deflate: return "deflate";
+    default: return "identity";
+  }
+}
+
+std::string Compression::compress(std::string_view input, Encoding encoding, int level) {
+  std::string output;
+  Stream stream(encoding, level);
+  stream.write(input, output);
+  stream.finish(output);
+  return output;
+}
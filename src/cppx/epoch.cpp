@@ -0,0 +1,110 @@
+#include "cppx/epoch.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct alignas(64) Slot {
+  std::atomic<uint64_t> epoch{0};
+  std::atomic<bool> claimed{false};
+};
+
+std::atomic<uint64_t> globalEpoch{1};
+Slot slots[Epoch::maxThreads];
+
+std::mutex retiredMutex;
+std::vector<std::pair<uint64_t, std::function<void()>>> retired;
+
+struct ThreadSlot {
+  Slot* slot = nullptr;
+
+  ~ThreadSlot() {
+    if (slot) {
+      slot->epoch.store(0, std::memory_order_release);
+      slot->claimed.store(false, std::memory_order_release);
+    }
+  }
+
+  Slot& get() {
+    if (!slot) {
+      for (auto& candidate : slots) {
+        bool expected = false;
+        if (candidate.claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+          slot = &candidate;
+          break;
+        }
+      }
+      if (!slot) {
+        throw std::runtime_error("Too many threads registered with Epoch.");
+      }
+    }
+    return *slot;
+  }
+};
+
+thread_local ThreadSlot threadSlot;
+
+}  // namespace
+
+Epoch::Guard::Guard() {
+  Slot& slot = threadSlot.get();
+  outermost_ = slot.epoch.load(std::memory_order_relaxed) == 0;
+  if (outermost_) {
+    slot.epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+  }
+}
+
+Epoch::Guard::~Guard() {
+  if (outermost_) {
+    threadSlot.slot->epoch.store(0, std::memory_order_release);
+  }
+}
+
+void Epoch::retire(std::function<void()> reclaim) {
+  // Readers that pinned an epoch older than this one may still see the retired object.
+  uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+  std::lock_guard<std::mutex> lock(retiredMutex);
+  retired.emplace_back(epoch, std::move(reclaim));
+}
+
+size_t Epoch::collect() {
+  // Anything retired after this snapshot may be held by a reader that pinned after the scan below, so it waits for the
+  // next collect.
+  uint64_t safeEpoch = globalEpoch.load(std::memory_order_seq_cst);
+  for (const auto& slot : slots) {
+    uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+    if (epoch != 0 && epoch < safeEpoch) {
+      safeEpoch = epoch;
+    }
+  }
+
+  std::vector<std::function<void()>> reclaimable;
+  {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    auto keep = retired.begin();
+    for (auto& entry : retired) {
+      if (entry.first <= safeEpoch) {
+        reclaimable.push_back(std::move(entry.second));
+      } else {
+        *keep++ = std::move(entry);
+      }
+    }
+    retired.erase(keep, retired.end());
+  }
+
+  for (auto& reclaim : reclaimable) {
+    reclaim();
+  }
+
+  return reclaimable.size();
+}
+
+size_t Epoch::pending() {
+  std::lock_guard<std::mutex> lock(retiredMutex);
+  return retired.size();
+}
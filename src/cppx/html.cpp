@@ -0,0 +1,187 @@
+#include "cppx/html.hpp"
+
+#include <string>
+
+std::string Html::render(const JSON& node) {
+  std::string output;
+  render(node, output);
+  return output;
+}
+
+void Html::render(const JSON& node, std::string& output) { render(node, output, nullptr); }
+
+void Html::render(const JSON& node, std::string& output, std::vector<const JSON::Callable*>* callables) {
+  switch (node.type()) {
+    case JSON::Type::Null:
+    case JSON::Type::Callable:
+      break;
+    case JSON::Type::Boolean:
+    case JSON::Type::Integer:
+    case JSON::Type::Floating:
+      renderScalar(node, output);
+      break;
+    case JSON::Type::String:
+      escape(node.value<JSON::String>(), output);
+      break;
+    case JSON::Type::Array:
+      for (const auto& child : node.value<JSON::Array>()) {
+        render(child, output, callables);
+      }
+      break;
+    case JSON::Type::Object:
+      for (const auto& [tagName, element] : node.value<JSON::Object>()) {
+        if (tagName == "html" && output.empty()) {
+          output += "<!DOCTYPE html>";
+        }
+        renderElement(tagName, element, output, callables);
+      }
+      break;
+  }
+}
+
+void Html::renderElement(const std::string& tagName, const JSON& element, std::string& output, std::vector<const JSON::Callable*>* callables) {
+  output += '<';
+  output += tagName;
+
+  const JSON* children = nullptr;
+
+  if (element.type() == JSON::Type::Object) {
+    for (const auto& [name, value] : element.value<JSON::Object>()) {
+      if (name == "children") {
+        children = &value;
+        continue;
+      }
+
+      switch (value.type()) {
+        case JSON::Type::Null:
+          break;
+        case JSON::Type::Callable:
+          // Callables are numbered in document order, so re-rendering the same tree yields the same IDs.
+          if (callables) {
+            output += ' ';
+            output += name;
+            output += "=\"cppx(";
+            output += std::to_string(callables->size());
+            output += ")\"";
+            callables->push_back(&value.value<JSON::Callable>());
+          }
+          break;
+        case JSON::Type::Boolean:
+          if (value.value<JSON::Boolean>()) {
+            output += ' ';
+            output += name;
+          }
+          break;
+        case JSON::Type::String:
+          output += ' ';
+          output += name;
+          output += "=\"";
+          escape(value.value<JSON::String>(), output);
+          output += '"';
+          break;
+        default:
+          output += ' ';
+          output += name;
+          output += "=\"";
+          renderScalar(value, output);
+          output += '"';
+          break;
+      }
+    }
+  }
+
+  output += '>';
+
+  if (isVoidElement(tagName)) {
+    return;
+  }
+
+  if (children) {
+    render(*children, output, callables);
+  }
+
+  output += "</";
+  output += tagName;
+  output += '>';
+}
+
+void Html::collect(const JSON& node, std::vector<const JSON::Callable*>& callables) {
+  if (node.type() == JSON::Type::Array) {
+    for (const auto& child : node.value<JSON::Array>()) {
+      collect(child, callables);
+    }
+    return;
+  }
+  if (node.type() != JSON::Type::Object) {
+    return;
+  }
+
+  // Same order as render(), so IDs match the ones in the rendered markup.
+  for (const auto& [tagName, element] : node.value<JSON::Object>()) {
+    if (element.type() != JSON::Type::Object) {
+      continue;
+    }
+
+    const JSON* children = nullptr;
+    for (const auto& [name, value] : element.value<JSON::Object>()) {
+      if (name == "children") {
+        children = &value;
+      } else if (value.type() == JSON::Type::Callable) {
+        callables.push_back(&value.value<JSON::Callable>());
+      }
+    }
+    if (children && !isVoidElement(tagName)) {
+      collect(*children, callables);
+    }
+  }
+}
+
+void Html::renderScalar(const JSON& value, std::string& output) {
+  switch (value.type()) {
+    case JSON::Type::Boolean:
+      output += value.value<JSON::Boolean>() ? "true" : "false";
+      break;
+    case JSON::Type::Integer:
+      output += std::to_string(value.value<JSON::Integer>());
+      break;
+    case JSON::Type::Floating:
+      output += value.stringify();
+      break;
+    default:
+      break;
+  }
+}
+
+void Html::escape(std::string_view text, std::string& output) {
+  for (char c : text) {
+    switch (c) {
+      case '&':
+        output += "&amp;";
+        break;
+      case '<':
+        output += "&lt;";
+        break;
+      case '>':
+        output += "&gt;";
+        break;
+      case '"':
+        output += "&quot;";
+        break;
+      case '\'':
+        output += "&#39;";
+        break;
+      default:
+        output += c;
+    }
+  }
+}
+
+bool Html::isVoidElement(const std::string& tagName) {
+  static const char* const voidElements[] = {"area", "base", "br", "col", "embed", "hr", "img", "input", "link", "meta", "source", "track", "wbr"};
+  for (const char* voidElement : voidElements) {
+    if (tagName == voidElement) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,196 @@
+#include "cppx/http.hpp"
+
+#include <cctype>
+
+namespace {
+
+bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size()) return false;
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(lhs[i])) != std::tolower(static_cast<unsigned char>(rhs[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string_view trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+  return value;
+}
+
+bool containsToken(std::string_view value, std::string_view token) {
+  while (!value.empty()) {
+    size_t comma = value.find(',');
+    if (equalsIgnoreCase(trim(value.substr(0, comma)), token)) return true;
+    if (comma == std::string_view::npos) break;
+    value.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+}  // namespace
+
+std::string_view HttpRequest::header(std::string_view name) const {
+  for (const auto& [key, value] : headers) {
+    if (equalsIgnoreCase(key, name)) {
+      return value;
+    }
+  }
+  return {};
+}
+
+HttpRequest::ParseResult HttpRequest::parse(std::string_view buffer, HttpRequest& request, size_t& consumed) {
+  size_t headerEnd = buffer.find("\r\n\r\n");
+  if (headerEnd == std::string_view::npos) {
+    return buffer.size() > maxHeaderSize ? ParseResult::Invalid : ParseResult::Incomplete;
+  }
+
+  std::string_view head = buffer.substr(0, headerEnd);
+  size_t lineEnd = head.find("\r\n");
+  std::string_view requestLine = head.substr(0, lineEnd);
+
+  size_t methodEnd = requestLine.find(' ');
+  if (methodEnd == std::string_view::npos) return ParseResult::Invalid;
+  size_t targetEnd = requestLine.find(' ', methodEnd + 1);
+  if (targetEnd == std::string_view::npos) return ParseResult::Invalid;
+
+  request.method = requestLine.substr(0, methodEnd);
+  request.target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+  std::string_view version = requestLine.substr(targetEnd + 1);
+
+  if (request.method.empty() || request.target.empty() || request.target.front() != '/') return ParseResult::Invalid;
+  if (version.size() != 8 || version.substr(0, 7) != "HTTP/1." || !std::isdigit(static_cast<unsigned char>(version[7]))) return ParseResult::Invalid;
+  request.minorVersion = version[7] - '0';
+
+  size_t queryStart = request.target.find('?');
+  request.path = request.target.substr(0, queryStart);
+  request.query = queryStart == std::string_view::npos ? std::string_view() : request.target.substr(queryStart + 1);
+
+  request.headers.clear();
+  while (lineEnd != std::string_view::npos) {
+    size_t lineStart = lineEnd + 2;
+    lineEnd = head.find("\r\n", lineStart);
+    std::string_view line = head.substr(lineStart, lineEnd == std::string_view::npos ? std::string_view::npos : lineEnd - lineStart);
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0) return ParseResult::Invalid;
+    request.headers.emplace_back(line.substr(0, colon), trim(line.substr(colon + 1)));
+  }
+
+  std::string_view connection = request.header("Connection");
+  request.keepAlive = request.minorVersion >= 1 ? !containsToken(connection, "close") : containsToken(connection, "keep-alive");
+
+  if (!request.header("Transfer-Encoding").empty()) {
+    return ParseResult::Invalid;
+  }
+
+  size_t bodySize = 0;
+  std::string_view contentLength = request.header("Content-Length");
+  for (char c : contentLength) {
+    if (!std::isdigit(static_cast<unsigned char>(c))) return ParseResult::Invalid;
+    bodySize = bodySize * 10 + (c - '0');
+    if (bodySize > maxBodySize) return ParseResult::Invalid;
+  }
+
+  size_t bodyStart = headerEnd + 4;
+  if (buffer.size() - bodyStart < bodySize) {
+    return ParseResult::Incomplete;
+  }
+
+  request.body = buffer.substr(bodyStart, bodySize);
+  consumed = bodyStart + bodySize;
+  return ParseResult::Complete;
+}
+
+std::string_view HttpResponse::reason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 410: return "Gone";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
+
+size_t HttpResponse::contentLength() const { return sharedBody ? sharedBody->size() : body.size(); }
+
+void HttpResponse::serializeHead(std::string& output) const {
+  output += "HTTP/1.1 ";
+  output += std::to_string(status);
+  output += ' ';
+  output += reason(status);
+  output += "\r\nContent-Type: ";
+  output += contentType;
+  if (chunked) {
+    output += "\r\nTransfer-Encoding: chunked\r\n";
+  } else {
+    output += "\r\nContent-Length: ";
+    output += std::to_string(contentLength());
+    output += "\r\n";
+  }
+
+  for (const auto& [name, value] : headers) {
+    output += name;
+    output += ": ";
+    output += value;
+    output += "\r\n";
+  }
+
+  if (!keepAlive) {
+    output += "Connection: close\r\n";
+  }
+
+  output += "\r\n";
+}
+
+void HttpResponse::serialize(std::string& output) const {
+  serializeHead(output);
+  output += sharedBody ? *sharedBody : body;
+}
+
+void HttpResponse::write(ResponseWriter& writer, bool includeBody) {
+  std::string head;
+  serializeHead(head);
+  writer.append(std::move(head));
+
+  if (!includeBody) {
+    return;
+  }
+
+  if (bodyFile) {
+    writer.appendFile(bodyFile);
+  } else if (sharedBody) {
+    writer.appendView(*sharedBody, sharedBody);
+  } else {
+    writer.append(std::move(body));
+  }
+}
+
+void HttpResponse::chunk(std::string_view data, std::string& output) {
+  if (data.empty()) {
+    return;
+  }
+
+  static const char digits[] = "0123456789abcdef";
+  char size[16];
+  int length = 0;
+  for (size_t value = data.size(); value > 0; value >>= 4) {
+    size[length++] = digits[value & 15];
+  }
+  while (length > 0) {
+    output += size[--length];
+  }
+
+  output += "\r\n";
+  output += data;
+  output += "\r\n";
+}
+
+void HttpResponse::lastChunk(std::string& output) { output += "0\r\n\r\n"; }
@@ -0,0 +1,175 @@
+#include "cppx/io_uring.hpp"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace {
+
+int setup(unsigned entries, io_uring_params& params) { return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params)); }
+
+int enter(int fd, unsigned submitted, unsigned wait, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, submitted, wait, flags, nullptr, 0));
+}
+
+int registerRing(int fd, unsigned opcode, void* argument, unsigned count) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, argument, count));
+}
+
+void* map(int fd, size_t size, off_t offset) {
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  if (address == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "Cannot map io_uring");
+  }
+  return address;
+}
+
+template <typename T>
+T* at(void* base, unsigned offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+IoUring::IoUring(unsigned entries, unsigned bufferCount, unsigned bufferSize) : bufferCount_(bufferCount), bufferSize_(bufferSize) {
+  io_uring_params params{};
+  // Completions are only reaped by the thread that submits, so the kernel need not interrupt it to run them.
+  params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+  fd_ = setup(entries, params);
+  if (fd_ < 0 && errno == EINVAL) {
+    params = {};
+    fd_ = setup(entries, params);
+  }
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "Cannot set up io_uring");
+  }
+
+  try {
+    if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_FAST_POLL)) {
+      throw std::system_error(ENOSYS, std::generic_category(), "io_uring lacks fast poll");
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    sqRing_ = map(fd_, sqRingSize_, IORING_OFF_SQ_RING);
+    cqRing_ = map(fd_, cqRingSize_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe*>(map(fd_, sqesSize_, IORING_OFF_SQES));
+
+    sqHead_ = at<unsigned>(sqRing_, params.sq_off.head);
+    sqTail_ = at<unsigned>(sqRing_, params.sq_off.tail);
+    sqMask_ = *at<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqArray_ = at<unsigned>(sqRing_, params.sq_off.array);
+    cqHead_ = at<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = at<unsigned>(cqRing_, params.cq_off.tail);
+    cqMask_ = *at<unsigned>(cqRing_, params.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+
+    // Receives pick a buffer from this group as data arrives, so idle connections hold none.
+    bufferRingSize_ = bufferCount_ * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, bufferRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* buffers = mmap(nullptr, static_cast<size_t>(bufferCount_) * bufferSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED || buffers == MAP_FAILED) {
+      if (ring != MAP_FAILED) munmap(ring, bufferRingSize_);
+      if (buffers != MAP_FAILED) munmap(buffers, static_cast<size_t>(bufferCount_) * bufferSize_);
+      throw std::system_error(errno, std::generic_category(), "Cannot allocate receive buffers");
+    }
+    bufferRing_ = static_cast<io_uring_buf_ring*>(ring);
+    buffers_ = static_cast<char*>(buffers);
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing_);
+    registration.ring_entries = bufferCount_;
+    registration.bgid = bufferGroup;
+    if (registerRing(fd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+      throw std::system_error(errno, std::generic_category(), "Cannot register receive buffers");
+    }
+
+    for (unsigned id = 0; id < bufferCount_; ++id) {
+      recycle(static_cast<uint16_t>(id));
+    }
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+IoUring::~IoUring() { release(); }
+
+void IoUring::release() {
+  if (buffers_) munmap(buffers_, static_cast<size_t>(bufferCount_) * bufferSize_);
+  if (bufferRing_) munmap(bufferRing_, bufferRingSize_);
+  if (sqes_) munmap(sqes_, sqesSize_);
+  if (cqRing_) munmap(cqRing_, cqRingSize_);
+  if (sqRing_) munmap(sqRing_, sqRingSize_);
+  if (fd_ >= 0) close(fd_);
+  buffers_ = nullptr;
+  bufferRing_ = nullptr;
+  sqes_ = nullptr;
+  cqRing_ = nullptr;
+  sqRing_ = nullptr;
+  fd_ = -1;
+}
+
+io_uring_sqe* IoUring::prepare(uint8_t opcode, int fd, uint64_t data) {
+  unsigned tail = *sqTail_;
+  if (tail - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire) >= sqEntries_) {
+    submit();
+  }
+
+  io_uring_sqe* sqe = &sqes_[tail & sqMask_];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->user_data = data;
+
+  sqArray_[tail & sqMask_] = tail & sqMask_;
+  std::atomic_ref<unsigned>(*sqTail_).store(tail + 1, std::memory_order_release);
+  ++queued_;
+  return sqe;
+}
+
+int IoUring::submit(bool wait) {
+  while (true) {
+    int result = enter(fd_, queued_, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+    if (result >= 0) {
+      queued_ -= std::min(queued_, static_cast<unsigned>(result));
+      return result;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      return -1;
+    }
+    if (!wait) {
+      return 0;
+    }
+  }
+}
+
+const io_uring_cqe* IoUring::peek() const {
+  unsigned head = *cqHead_;
+  if (head == std::atomic_ref<unsigned>(*cqTail_).load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &cqes_[head & cqMask_];
+}
+
+void IoUring::advance() { std::atomic_ref<unsigned>(*cqHead_).store(*cqHead_ + 1, std::memory_order_release); }
+
+void IoUring::recycle(uint16_t id) {
+  // Indexed by hand: in C++ the header's flexible array member sits after an empty struct that takes up space.
+  io_uring_buf& entry = reinterpret_cast<io_uring_buf*>(bufferRing_)[bufferTail_ & (bufferCount_ - 1)];
+  entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+  entry.len = bufferSize_;
+  entry.bid = id;
+  std::atomic_ref<uint16_t>(bufferRing_->tail).store(++bufferTail_, std::memory_order_release);
+}
@@ -1,5 +1,25 @@
 #include "cppx/json.hpp"
 
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+#if !defined(CPPX_NO_TRACE)
+thread_local uint64_t valuesBuiltCount = 0;
+#endif
+
+// Counted only for the per-route metrics, so a build without tracing does no work here.
+inline void countValue() {
+#if !defined(CPPX_NO_TRACE)
+  valuesBuiltCount++;
+#endif
+}
+
+}  // namespace
+
 JSON::JSON() : type_(Type::Null), value_(std::in_place_type<std::monostate>) {}
 
 JSON::JSON(Null) : type_(Type::Null), value_(std::in_place_type<std::monostate>) {}
@@ -10,19 +30,21 @@ JSON::JSON(Integer value) : type_(Type::Integer), value_(std::in_place_type<Inte
 
 JSON::JSON(Floating value) : type_(Type::Floating), value_(std::in_place_type<Floating>, value) {}
 
-JSON::JSON(const String& value) : type_(Type::String), value_(std::in_place_type<String>, value) {}
+JSON::JSON(const String& value) : type_(Type::String), value_(std::in_place_type<String>, value) { countValue(); }
 
-JSON::JSON(String&& value) : type_(Type::String), value_(std::in_place_type<String>, std::move(value)) {}
+JSON::JSON(String&& value) : type_(Type::String), value_(std::in_place_type<String>, std::move(value)) { countValue(); }
 
-JSON::JSON(const char* value) : type_(Type::String), value_(std::in_place_type<String>, value) {}
+JSON::JSON(const char* value) : type_(Type::String), value_(std::in_place_type<String>, value) { countValue(); }
 
-JSON::JSON(const Array& value) : type_(Type::Array), value_(std::in_place_type<Array>, value) {}
+JSON::JSON(std::string_view value) : type_(Type::String), value_(std::in_place_type<String>, value) { countValue(); }
 
-JSON::JSON(Array&& value) : type_(Type::Array), value_(std::in_place_type<Array>, std::move(value)) {}
+JSON::JSON(const Array& value) : type_(Type::Array), value_(std::in_place_type<Array>, value) { countValue(); }
 
-JSON::JSON(const Object& value) : type_(Type::Object), value_(std::in_place_type<Object>, value) {}
+JSON::JSON(Array&& value) : type_(Type::Array), value_(std::in_place_type<Array>, std::move(value)) { countValue(); }
 
-JSON::JSON(Object&& value) : type_(Type::Object), value_(std::in_place_type<Object>, std::move(value)) {}
+JSON::JSON(const Object& value) : type_(Type::Object), value_(std::in_place_type<Object>, value) { countValue(); }
+
+JSON::JSON(Object&& value) : type_(Type::Object), value_(std::in_place_type<Object>, std::move(value)) { countValue(); }
 
 JSON::JSON(std::initializer_list<JSON> init) {
   if (init.size() % 2 != 0) {
@@ -46,6 +68,15 @@ JSON::JSON(std::initializer_list<JSON> init) {
   }
   type_ = Type::Object;
   value_.emplace<Object>(std::move(obj));
+  countValue();
+}
+
+uint64_t JSON::valuesBuilt() {
+#if defined(CPPX_NO_TRACE)
+  return 0;
+#else
+  return valuesBuiltCount;
+#endif
 }
 
 JSON::operator Null() const {
@@ -1,16 +1,25 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <regex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "cppx/build_state.hpp"
+#include "cppx/cache.hpp"
 #include "cppx/preprocessor.hpp"
+#include "cppx/profile.hpp"
+#include "cppx/scheduler.hpp"
+#include "cppx/trace.hpp"
+#include "cppx/watcher.hpp"
 
 std::string readFile(const std::filesystem::path& filePath) {
   std::ifstream inputFile(filePath);
@@ -30,117 +39,309 @@ void writeFile(const std::filesystem::path& filePath, const std::string& content
   outputFile << content;
 }
 
-void copyAndProcessFiles(const std::filesystem::path& sourceDir, const std::filesystem::path& destinationDir) {
-  if (!std::filesystem::exists(sourceDir)) {
-    return;
+bool writeFileIfChanged(const std::filesystem::path& filePath, const std::string& content) {
+  std::error_code error;
+  auto existingSize = std::filesystem::file_size(filePath, error);
+  if (!error && existingSize == content.size() && readFile(filePath) == content) {
+    return false;
   }
+  writeFile(filePath, content);
+  return true;
+}
 
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(sourceDir)) {
-    if (entry.is_regular_file()) {
-      auto relativePath = std::filesystem::relative(entry.path(), sourceDir);
-      auto destinationPath = destinationDir / relativePath;
+std::string processFile(const std::filesystem::path& sourcePath, const std::string& sourceContent, bool isRouter, std::ostream& diagnostics) {
+  std::string fileContent = sourceContent;
 
-      if (entry.path().extension() == ".cppx") {
-        destinationPath.replace_extension(".cpp");
-      }
+  std::string warning = "// Warning: This is a generated file. Do not modify directly.\n";
 
-      try {
-        std::filesystem::create_directories(destinationPath.parent_path());
-      } catch (const std::filesystem::filesystem_error& error) {
-        std::cerr << "Error: Failed to create directories for " << destinationPath << ": " << error.what() << std::endl;
-        continue;
-      }
+  if (sourcePath.extension() == ".cppx") {
+    std::string processedContent = Preprocessor::Process(fileContent, diagnostics);
+    fileContent = warning + processedContent;
+  } else {
+    fileContent = warning + fileContent;
+  }
 
-      std::string fileContent = readFile(entry.path());
+  if (isRouter) {
+    std::regex asyncFunctionPattern(R"(\bAsyncPage\s+(\w+)\s*\()");
+    std::regex functionPattern(R"(\bPage\s+(\w+)\s*\()");
+    std::smatch match;
+
+    if (std::regex_search(fileContent, match, asyncFunctionPattern) && match.size() > 1) {
+      std::string externDeclaration = "extern \"C\" AsyncPageFunction getAsyncPageFunction() { return &" + match[1].str() + "; }\n";
+      fileContent += "\n" + externDeclaration;
+    } else if (std::regex_search(fileContent, match, functionPattern) && match.size() > 1) {
+      std::string pageName = match[1].str();
+      fileContent = std::regex_replace(fileContent, functionPattern, "Page " + pageName + "(");
+      std::string externDeclaration = "extern \"C\" PageFunction getPageFunction() { return &" + pageName + "; }\n";
+      fileContent += "\n" + externDeclaration;
+    }
+  }
 
-      std::string warning = "// Warning: This is a generated file. Do not modify directly.\n";
+  return fileContent;
+}
 
-      if (entry.path().extension() == ".cppx") {
-        std::string processedContent = Preprocessor::Process(fileContent);
-        fileContent = warning + processedContent;
-      } else {
-        fileContent = warning + fileContent;
-      }
+void copyAndProcessFile(const std::filesystem::path& sourcePath, const std::filesystem::path& sourceDir, const std::filesystem::path& destinationDir, const Cache& cache,
+                        std::ostream& diagnostics = std::cout) {
+  Trace::Span span("preprocess", sourcePath.native());
+  Profile::Step step("preprocess", sourcePath.native());
+  bool isRouter = destinationDir.string().find(".cppx/router") != std::string::npos;
 
-      if (destinationDir.string().find(".cppx/router") != std::string::npos) {
-        std::regex functionPattern(R"(\bPage\s+(\w+)\s*\()");
-        std::smatch match;
+  auto relativePath = std::filesystem::relative(sourcePath, sourceDir);
+  auto destinationPath = destinationDir / relativePath;
 
-        if (std::regex_search(fileContent, match, functionPattern) && match.size() > 1) {
-          std::string pageName = match[1].str();
-          fileContent = std::regex_replace(fileContent, functionPattern, "Page " + pageName + "(");
-          std::string externDeclaration = "extern \"C\" PageFunction getPageFunction() { return &" + pageName + "; }\n";
-          fileContent += "\n" + externDeclaration;
-        }
+  if (sourcePath.extension() == ".cppx") {
+    destinationPath.replace_extension(".cpp");
+  }
+
+  if (!std::filesystem::exists(sourcePath)) {
+    std::error_code error;
+    std::filesystem::remove(destinationPath, error);
+    return;
+  }
+
+  try {
+    std::filesystem::create_directories(destinationPath.parent_path());
+  } catch (const std::filesystem::filesystem_error& error) {
+    std::cerr << "Error: Failed to create directories for " << destinationPath << ": " << error.what() << std::endl;
+    return;
+  }
+
+  std::string sourceContent = readFile(sourcePath);
+  std::string cacheKey = Cache::hash(Preprocessor::version + "\n" + sourcePath.extension().string() + "\n" + (isRouter ? "router" : "") + "\n" + sourceContent);
+
+  std::string fileContent;
+  if (auto cachedContent = cache.get(cacheKey)) {
+    fileContent = std::move(*cachedContent);
+  } else {
+    fileContent = processFile(sourcePath, sourceContent, isRouter, diagnostics);
+    cache.put(cacheKey, fileContent);
+  }
+
+  writeFileIfChanged(destinationPath, fileContent);
+}
+
+// Preprocesses every file under the source directories on jobs threads. Each file's diagnostics are buffered and
+// printed in file order once all of them are done, so the output does not depend on the job count.
+void copyAndProcessFiles(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& sourceDirs, const Cache& cache, size_t jobs) {
+  struct File {
+    std::filesystem::path sourcePath;
+    const std::filesystem::path* sourceDir;
+    const std::filesystem::path* destinationDir;
+    std::ostringstream diagnostics;
+  };
+  std::vector<File> files;
+  for (const auto& [sourceDir, destinationDir] : sourceDirs) {
+    if (!std::filesystem::exists(sourceDir)) {
+      continue;
+    }
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(sourceDir)) {
+      if (entry.is_regular_file()) {
+        files.push_back({entry.path(), &sourceDir, &destinationDir, {}});
       }
+    }
+  }
 
-      writeFile(destinationPath, fileContent);
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      copyAndProcessFile(files[i].sourcePath, *files[i].sourceDir, *files[i].destinationDir, cache, files[i].diagnostics);
     }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < std::min(jobs, files.size()); ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  for (const auto& file : files) {
+    std::cout << file.diagnostics.str();
   }
+  std::cout << std::flush;
 }
 
-void build() {
-  const std::string projectAlias = "example";
-  const std::filesystem::path includeSourceDir = "include/" + projectAlias;
-  const std::filesystem::path routerSourceDir = "router/" + projectAlias;
-  const std::filesystem::path srcSourceDir = "src/" + projectAlias;
+bool isWithin(const std::filesystem::path& path, const std::filesystem::path& directory) {
+  auto relativePath = path.lexically_normal().lexically_relative(directory.lexically_normal());
+  return !relativePath.empty() && *relativePath.begin() != "..";
+}
 
-  const std::filesystem::path includeDestinationDir = ".cppx/include/" + projectAlias;
-  const std::filesystem::path routerDestinationDir = ".cppx/router/" + projectAlias;
-  const std::filesystem::path srcDestinationDir = ".cppx/src/" + projectAlias;
+std::string generateMain(const std::string& projectAlias) {
+  std::ostringstream mainContentStream;
+  mainContentStream << "// Warning: This is a generated file. Do not modify directly.\n"
+                    << "#include <utility>\n"
+                    << "#include \"cppx/server.hpp\"\n"
+                    << "\n"
+                    << "int main(int argc, char* argv[]) {\n"
+                    << "    ServerOptions options = ServerOptions::parse(argc, argv);\n"
+                    << "    options.routerDirectory = \".cppx/build/" << projectAlias << "/bin/router/" << projectAlias << "\";\n"
+                    << "\n"
+                    << "    Server server(std::move(options));\n"
+                    << "    return server.run();\n"
+                    << "}\n";
 
-  copyAndProcessFiles(includeSourceDir, includeDestinationDir);
-  copyAndProcessFiles(routerSourceDir, routerDestinationDir);
-  copyAndProcessFiles(srcSourceDir, srcDestinationDir);
+  return mainContentStream.str();
+}
 
-  const std::filesystem::path mainCppPath = ".cppx/src/main.cpp";
-  std::filesystem::create_directories(mainCppPath.parent_path());
+bool isAsyncRoute(const std::filesystem::path& routePath) { return readFile(routePath).find("getAsyncPageFunction()") != std::string::npos; }
+
+std::string generateBundledMain(const std::vector<std::pair<std::string, std::filesystem::path>>& routes) {
+  std::vector<bool> async;
+  size_t asyncCount = 0;
+  for (const auto& route : routes) {
+    async.push_back(isAsyncRoute(route.second));
+    asyncCount += async.back();
+  }
 
   std::ostringstream mainContentStream;
   mainContentStream << "// Warning: This is a generated file. Do not modify directly.\n"
-                    << "#include <iostream>\n"
-                    << "#include <dlfcn.h>\n"
-                    << "#include <string>\n"
-                    << "#include \"cppx/json.hpp\"\n"
-                    << "#include \"cppx/page.hpp\"\n"
+                    << "#include <array>\n"
+                    << "#include <string_view>\n"
+                    << "#include <utility>\n"
+                    << "#include \"cppx/server.hpp\"\n"
+                    << "\n";
+
+  for (size_t i = 0; i < routes.size(); ++i) {
+    mainContentStream << "extern \"C\" " << (async[i] ? "AsyncPageFunction" : "PageFunction") << " cppx_route_" << i << "();\n";
+  }
+
+  mainContentStream << "\n"
+                    << "using GetPageFunction = PageFunction (*)();\n"
+                    << "using GetAsyncPageFunction = AsyncPageFunction (*)();\n"
                     << "\n"
-                    << "int main() {\n"
-                    << "    std::string input;\n"
-                    << "    std::cout << \"> \";\n"
-                    << "    std::cin >> input;\n"
+                    << "constexpr std::array<std::pair<std::string_view, GetPageFunction>, " << routes.size() - asyncCount << "> routes = {{\n";
+
+  for (size_t i = 0; i < routes.size(); ++i) {
+    if (!async[i]) mainContentStream << "    {\"" << routes[i].first << "\", &cppx_route_" << i << "},\n";
+  }
+
+  mainContentStream << "}};\n"
                     << "\n"
-                    << "    std::string sharedObjectPath = \".cppx/build/" << projectAlias << "/bin/router/" << projectAlias << "/\" + input + \"/page.so\";\n"
-                    << "    void* handle = dlopen(sharedObjectPath.c_str(), RTLD_NOW);\n"
-                    << "    if (!handle) {\n"
-                    << "        std::cerr << \"404 Page Not Found\" << std::endl;\n"
-                    << "        return 1;\n"
-                    << "    }\n"
+                    << "constexpr std::array<std::pair<std::string_view, GetAsyncPageFunction>, " << asyncCount << "> asyncRoutes = {{\n";
+
+  for (size_t i = 0; i < routes.size(); ++i) {
+    if (async[i]) mainContentStream << "    {\"" << routes[i].first << "\", &cppx_route_" << i << "},\n";
+  }
+
+  mainContentStream << "}};\n"
                     << "\n"
-                    << "    typedef PageFunction (*GetPageFunction)();\n"
-                    << "    GetPageFunction getPageFunction = (GetPageFunction)dlsym(handle, \"getPageFunction\");\n"
-                    << "    if (!getPageFunction) {\n"
-                    << "        std::cerr << \"404 Page Not Found\" << std::endl;\n"
-                    << "        dlclose(handle);\n"
-                    << "        return 1;\n"
+                    << "int main(int argc, char* argv[]) {\n"
+                    << "    ServerOptions options = ServerOptions::parse(argc, argv);\n"
+                    << "    for (const auto& [route, getPageFunction] : routes) {\n"
+                    << "        options.routes.emplace_back(route, getPageFunction());\n"
                     << "    }\n"
-                    << "\n"
-                    << "    PageFunction pageFunction = getPageFunction();\n"
-                    << "    {\n"
-                    << "        JSON page = pageFunction();\n"
-                    << "        std::cout << page << std::endl;\n"
+                    << "    for (const auto& [route, getAsyncPageFunction] : asyncRoutes) {\n"
+                    << "        options.asyncRoutes.emplace_back(route, getAsyncPageFunction());\n"
                     << "    }\n"
                     << "\n"
-                    << "    dlclose(handle);\n"
-                    << "    return 0;\n"
+                    << "    Server server(std::move(options));\n"
+                    << "    return server.run();\n"
                     << "}\n";
 
-  std::string mainContent = mainContentStream.str();
-  writeFile(mainCppPath, mainContent);
+  return mainContentStream.str();
+}
+
+std::string generateBundledRoute(const std::filesystem::path& routePath, const std::filesystem::path& bundlePath, size_t index) {
+  std::ostringstream bundleContentStream;
+  bundleContentStream << "// Warning: This is a generated file. Do not modify directly.\n";
+
+  // Headers are included ahead of the anonymous namespace so their guards turn the page's own includes into no-ops.
+  std::istringstream routeContent(readFile(routePath));
+  std::regex includePattern(R"(^\s*#\s*include\b.*$)");
+  std::string line;
+  while (std::getline(routeContent, line)) {
+    if (std::regex_match(line, includePattern)) {
+      bundleContentStream << line << "\n";
+    }
+  }
+
+  std::string relativeRoutePath = std::filesystem::relative(routePath, bundlePath.parent_path()).generic_string();
+
+  bundleContentStream << "\n"
+                      << "#define getPageFunction cppx_route_" << index << "\n"
+                      << "#define getAsyncPageFunction cppx_route_" << index << "\n"
+                      << "namespace {\n"
+                      << "#include \"" << relativeRoutePath << "\"\n"
+                      << "}\n"
+                      << "#undef getPageFunction\n"
+                      << "#undef getAsyncPageFunction\n";
+
+  return bundleContentStream.str();
+}
+
+void build(size_t jobs, bool release, const std::vector<std::filesystem::path>* changedFiles = nullptr) {
+  const std::string projectAlias = "example";
+  const std::filesystem::path includeSourceDir = "include/" + projectAlias;
+  const std::filesystem::path routerSourceDir = "router/" + projectAlias;
+  const std::filesystem::path srcSourceDir = "src/" + projectAlias;
+
+  const std::filesystem::path includeDestinationDir = ".cppx/include/" + projectAlias;
+  const std::filesystem::path routerDestinationDir = ".cppx/router/" + projectAlias;
+  const std::filesystem::path srcDestinationDir = ".cppx/src/" + projectAlias;
 
   const std::filesystem::path buildBaseDir = ".cppx/build/" + projectAlias;
   const std::filesystem::path buildLibDir = buildBaseDir / "lib";
   const std::filesystem::path buildBinDir = buildBaseDir / "bin";
 
+  const Cache cache(".cppx/cache");
+
+  const std::vector<std::pair<std::filesystem::path, std::filesystem::path>> sourceDirs = {
+    {includeSourceDir, includeDestinationDir},
+    {routerSourceDir, routerDestinationDir},
+    {srcSourceDir, srcDestinationDir}
+  };
+
+  bool routesOnly = changedFiles != nullptr && !release;
+  std::set<std::filesystem::path> changedRoutes;
+
+  if (changedFiles) {
+    for (const auto& changedFile : *changedFiles) {
+      bool isRoute = false;
+      for (const auto& [sourceDir, destinationDir] : sourceDirs) {
+        if (isWithin(changedFile, sourceDir)) {
+          copyAndProcessFile(changedFile, sourceDir, destinationDir, cache);
+          if (sourceDir == routerSourceDir) {
+            auto routePath = destinationDir / std::filesystem::relative(changedFile, sourceDir);
+            routePath.replace_extension(".cpp");
+            changedRoutes.insert(routePath.lexically_normal());
+            isRoute = true;
+
+            if (!std::filesystem::exists(changedFile)) {
+              // Removing the page's library is what takes the route down in a running server.
+              auto sharedObjectDir = buildBinDir / std::filesystem::relative(routePath, ".cppx").parent_path();
+              std::error_code error;
+              std::filesystem::remove(sharedObjectDir / "page.so", error);
+              std::filesystem::remove(sharedObjectDir / "page.d", error);
+            }
+          }
+        }
+      }
+      routesOnly = routesOnly && isRoute;
+    }
+  } else {
+    copyAndProcessFiles(sourceDirs, cache, jobs);
+    cache.prune();
+  }
+
+  std::vector<std::pair<std::string, std::filesystem::path>> bundledRoutes;
+
+  if (release) {
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(routerDestinationDir)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".cpp") {
+        std::string route = std::filesystem::relative(entry.path().parent_path(), routerDestinationDir).generic_string();
+        bundledRoutes.emplace_back(route == "." ? "" : route, entry.path());
+      }
+    }
+    std::sort(bundledRoutes.begin(), bundledRoutes.end());
+  }
+
+  const std::filesystem::path mainCppPath = ".cppx/src/main.cpp";
+  std::filesystem::create_directories(mainCppPath.parent_path());
+
+  std::string mainContent = release ? generateBundledMain(bundledRoutes) : generateMain(projectAlias);
+  writeFileIfChanged(mainCppPath, mainContent);
+
   std::filesystem::create_directories(buildLibDir);
   std::filesystem::create_directories(buildBinDir);
 
@@ -156,23 +357,38 @@ void build() {
     }
   }
 
+  const std::string optimizationFlags = release ? "-O3 -flto" : "-O3";
+  const std::string linkFlags = release ? "-O3 -flto" : "-O3 -fno-lto";
+
+  Scheduler scheduler(jobs);
+  const BuildState buildState(buildBaseDir / "state");
+
+  auto addTarget = [&](const std::string& command, const std::string& errorMessage, const std::vector<Scheduler::JobId>& dependencies, const std::filesystem::path& output, const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& dependencyFile) {
+    return scheduler.add(
+        command, errorMessage, dependencies,
+        [&buildState, command, output, inputs, dependencyFile] { return buildState.upToDate(output, command, inputs, dependencyFile); },
+        [&buildState, command, output, inputs, dependencyFile] { buildState.record(output, command, inputs, dependencyFile); });
+  };
+
+  const std::filesystem::path cppxArchivePath = "build/cppx/lib/libcppx.a";
+  std::vector<std::filesystem::path> archiveInputs = {cppxArchivePath};
   std::vector<std::filesystem::path> libraryObjectFiles;
+  std::vector<Scheduler::JobId> libraryObjectJobs;
+  std::vector<Scheduler::JobId> libraryJobs;
   bool hasLibrary = !librarySources.empty();
 
-  if (hasLibrary) {
+  if (hasLibrary && !routesOnly) {
     for (const auto& sourceFile : librarySources) {
       auto relativePath = std::filesystem::relative(sourceFile, ".cppx");
       auto objectPath = buildLibDir / relativePath;
       objectPath.replace_extension(".o");
+      auto dependencyPath = objectPath;
+      dependencyPath.replace_extension(".d");
 
       std::filesystem::create_directories(objectPath.parent_path());
 
-      std::string compileCommand = "g++ -c \"" + sourceFile.string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 -O3 -fPIC -o \"" + objectPath.string() + "\"";
-      if (std::system(compileCommand.c_str()) != 0) {
-        std::cerr << "Error: Compilation failed for " << sourceFile << std::endl;
-        return;
-      }
-
+      std::string compileCommand = "g++ -c \"" + sourceFile.string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 " + optimizationFlags + " -fPIC -MMD -MF \"" + dependencyPath.string() + "\" -o \"" + objectPath.string() + "\"";
+      libraryObjectJobs.push_back(addTarget(compileCommand, "Compilation failed for " + sourceFile.string(), {}, objectPath, {}, dependencyPath));
       libraryObjectFiles.push_back(objectPath);
     }
 
@@ -182,62 +398,167 @@ void build() {
       archiveCommand += " \"" + objectFile.string() + "\"";
     }
 
-    if (std::system(archiveCommand.c_str()) != 0) {
-      std::cerr << "Error: Archiving failed for " << archivePath << std::endl;
-      return;
-    }
+    libraryJobs.push_back(addTarget(archiveCommand, "Archiving failed for " + archivePath.string(), libraryObjectJobs, archivePath, libraryObjectFiles, {}));
   }
 
-  auto mainObjectPath = buildBinDir / "main.o";
-  std::string mainCompileCommand = "g++ -c \"" + mainCppPath.string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 -O3 -o \"" + mainObjectPath.string() + "\"";
-  if (std::system(mainCompileCommand.c_str()) != 0) {
-    std::cerr << "Error: Compilation failed for main.cpp" << std::endl;
-    return;
+  if (hasLibrary) {
+    archiveInputs.insert(archiveInputs.begin(), buildLibDir / ("lib" + projectAlias + ".a"));
   }
 
-  auto mainExecutablePath = buildBinDir / "main";
-  std::string mainLinkCommand = "g++ \"" + mainObjectPath.string() + "\"";
+  const std::filesystem::path preludePath = buildBaseDir / "pch" / "prelude.hpp";
+  const std::filesystem::path preludeOutputPath = buildBaseDir / "pch" / "prelude.hpp.gch";
+  const std::filesystem::path preludeDependencyPath = buildBaseDir / "pch" / "prelude.d";
 
-  if (hasLibrary) {
-    mainLinkCommand += " -L\"" + buildLibDir.string() + "\" -l" + projectAlias;
+  std::filesystem::create_directories(preludePath.parent_path());
+  writeFileIfChanged(preludePath, Preprocessor::header);
+
+  std::vector<Scheduler::JobId> pageDependencies = libraryJobs;
+  std::vector<std::filesystem::path> pageInputs = archiveInputs;
+  pageInputs.push_back(preludeOutputPath);
+
+  if (!routesOnly && !release) {
+    std::string preludeCommand = "g++ -x c++-header \"" + preludePath.string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 -O3 -fPIC -MMD -MF \"" + preludeDependencyPath.string() + "\" -o \"" + preludeOutputPath.string() + "\"";
+    pageDependencies.push_back(addTarget(preludeCommand, "Precompiling page header failed", {}, preludeOutputPath, {}, preludeDependencyPath));
   }
 
-  mainLinkCommand += " -L\"build/cppx/lib\" -lcppx -ldl -std=c++20 -O3 -o \"" + mainExecutablePath.string() + "\"";
+  std::vector<std::filesystem::path> bundledObjectFiles;
+  std::vector<Scheduler::JobId> bundledObjectJobs;
 
-  if (std::system(mainLinkCommand.c_str()) != 0) {
-    std::cerr << "Error: Linking failed for main executable" << std::endl;
-    return;
+  for (size_t i = 0; i < bundledRoutes.size(); ++i) {
+    const auto& routePath = bundledRoutes[i].second;
+    auto bundlePath = buildBaseDir / "bundle" / ("route_" + std::to_string(i) + ".cpp");
+    auto objectPath = buildBaseDir / "bundle" / ("route_" + std::to_string(i) + ".o");
+    auto dependencyPath = buildBaseDir / "bundle" / ("route_" + std::to_string(i) + ".d");
+
+    std::filesystem::create_directories(bundlePath.parent_path());
+    writeFileIfChanged(bundlePath, generateBundledRoute(routePath, bundlePath, i));
+
+    std::string compileCommand = "g++ -c \"" + bundlePath.string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 " + optimizationFlags + " -MMD -MF \"" + dependencyPath.string() + "\" -o \"" + objectPath.string() + "\"";
+    bundledObjectJobs.push_back(addTarget(compileCommand, "Compilation failed for " + routePath.string(), {}, objectPath, {}, dependencyPath));
+    bundledObjectFiles.push_back(objectPath);
   }
 
-  for (const auto& entry : std::filesystem::recursive_directory_iterator(".cppx/router")) {
-    if (entry.is_regular_file()) {
-      if (entry.path().extension() == ".cpp") {
-        auto relativePath = std::filesystem::relative(entry.path(), ".cppx");
-        auto sharedObjectDir = buildBinDir / relativePath.parent_path();
-        auto sharedObjectPath = sharedObjectDir / "page.so";
+  if (!routesOnly) {
+    auto mainObjectPath = buildBinDir / "main.o";
+    auto mainDependencyPath = buildBinDir / "main.d";
+    std::string mainCompileCommand = "g++ -c \"" + mainCppPath.string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 " + optimizationFlags + " -MMD -MF \"" + mainDependencyPath.string() + "\" -o \"" + mainObjectPath.string() + "\"";
+    Scheduler::JobId mainCompileJob = addTarget(mainCompileCommand, "Compilation failed for main.cpp", {}, mainObjectPath, {}, mainDependencyPath);
 
-        std::filesystem::create_directories(sharedObjectDir);
+    auto mainExecutablePath = buildBinDir / "main";
+    std::string mainLinkCommand = "g++ \"" + mainObjectPath.string() + "\"";
 
-        std::string buildCommand = "g++ -fPIC -shared \"" + entry.path().string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 -O3";
+    for (const auto& objectFile : bundledObjectFiles) {
+      mainLinkCommand += " \"" + objectFile.string() + "\"";
+    }
 
-        if (hasLibrary) {
-          buildCommand += " -L\"" + buildLibDir.string() + "\" -l" + projectAlias;
-        }
+    if (hasLibrary) {
+      mainLinkCommand += " -L\"" + buildLibDir.string() + "\" -l" + projectAlias;
+    }
 
-        buildCommand += " -L\"build/cppx/lib\" -lcppx -o \"" + sharedObjectPath.string() + "\"";
+    mainLinkCommand += " -L\"build/cppx/lib\" -lcppx -ldl -lz -rdynamic -std=c++20 " + linkFlags + " -o \"" + mainExecutablePath.string() + "\"";
+
+    std::vector<Scheduler::JobId> mainLinkDependencies = libraryJobs;
+    mainLinkDependencies.push_back(mainCompileJob);
+    mainLinkDependencies.insert(mainLinkDependencies.end(), bundledObjectJobs.begin(), bundledObjectJobs.end());
+    std::vector<std::filesystem::path> mainLinkInputs = archiveInputs;
+    mainLinkInputs.insert(mainLinkInputs.begin(), bundledObjectFiles.begin(), bundledObjectFiles.end());
+    mainLinkInputs.insert(mainLinkInputs.begin(), mainObjectPath);
+    addTarget(mainLinkCommand, "Linking failed for main executable", mainLinkDependencies, mainExecutablePath, mainLinkInputs, {});
+  }
 
-        if (std::system(buildCommand.c_str()) != 0) {
-          std::cerr << "Error: Building bundle failed for " << entry.path() << std::endl;
-          return;
+  if (!release) {
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(".cppx/router")) {
+      if (entry.is_regular_file()) {
+        if (entry.path().extension() == ".cpp") {
+          if (routesOnly && changedRoutes.count(entry.path().lexically_normal()) == 0) {
+            continue;
+          }
+
+          auto relativePath = std::filesystem::relative(entry.path(), ".cppx");
+          auto sharedObjectDir = buildBinDir / relativePath.parent_path();
+          auto sharedObjectPath = sharedObjectDir / "page.so";
+          auto dependencyPath = sharedObjectDir / "page.d";
+
+          std::filesystem::create_directories(sharedObjectDir);
+
+          std::string buildCommand = "g++ -fPIC -shared -include \"" + preludePath.string() + "\" \"" + entry.path().string() + "\" -I\".cppx/include\" -I\"include\" -std=c++20 " + linkFlags + " -MMD -MF \"" + dependencyPath.string() + "\"";
+
+          if (hasLibrary) {
+            buildCommand += " -L\"" + buildLibDir.string() + "\" -l" + projectAlias;
+          }
+
+          // Link beside the target and rename, so a running server never loads a half-written page.
+          buildCommand += " -L\"build/cppx/lib\" -lcppx -o \"" + sharedObjectPath.string() + ".tmp\" && mv -f \"" + sharedObjectPath.string() + ".tmp\" \"" + sharedObjectPath.string() + "\"";
+
+          addTarget(buildCommand, "Building bundle failed for " + entry.path().string(), pageDependencies, sharedObjectPath, pageInputs, dependencyPath);
         }
       }
     }
   }
 
+  if (!scheduler.run()) {
+    return;
+  }
+
   std::cout << "Build completed successfully!" << std::endl;
 }
 
+void report(const std::filesystem::path& traceFile, const std::filesystem::path& profileFile) {
+  if (!traceFile.empty()) Trace::write(traceFile);
+  if (!profileFile.empty()) {
+    Profile::summarize(std::cout);
+    Profile::write(profileFile);
+    Profile::clear();
+  }
+}
+
+void watch(size_t jobs, bool release, const std::filesystem::path& traceFile, const std::filesystem::path& profileFile) {
+  Watcher watcher({"router", "include", "src"});
+
+  build(jobs, release);
+  report(traceFile, profileFile);
+
+  std::cout << "Watching for changes..." << std::endl;
+
+  while (true) {
+    std::vector<std::filesystem::path> changedFiles = watcher.wait();
+    if (watcher.overflowed()) {
+      std::cerr << "Warning: Missed file changes, rebuilding everything." << std::endl;
+      build(jobs, release);
+    } else {
+      build(jobs, release, &changedFiles);
+    }
+    report(traceFile, profileFile);
+  }
+}
+
 int main(int argc, char* argv[]) {
-  build();
+  size_t jobs = Scheduler::parseJobs(argc, argv);
+
+  bool watchMode = false;
+  bool release = false;
+  std::filesystem::path traceFile;
+  std::filesystem::path profileFile;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "-w" || std::string(argv[i]) == "--watch") {
+      watchMode = true;
+    } else if (std::string(argv[i]) == "--release") {
+      release = true;
+    } else if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+      traceFile = argv[++i];
+      Trace::enableSpans();
+    } else if (std::string(argv[i]) == "--profile" && i + 1 < argc) {
+      profileFile = argv[++i];
+      Profile::enable();
+    }
+  }
+
+  if (watchMode) {
+    watch(jobs, release, traceFile, profileFile);
+  } else {
+    build(jobs, release);
+    report(traceFile, profileFile);
+  }
+
   return 0;
 }
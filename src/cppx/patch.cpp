@@ -0,0 +1,251 @@
+#include "cppx/patch.hpp"
+
+#include <algorithm>
+
+#include "cppx/html.hpp"
+
+std::string Patch::diff(const JSON& before, const Callables& beforeCallables, const JSON& after, const Callables& afterCallables, uint32_t generation) {
+  Context context;
+  for (size_t i = 0; i < beforeCallables.size(); ++i) context.beforeIds[beforeCallables[i]] = i;
+  for (size_t i = 0; i < afterCallables.size(); ++i) context.afterIds[afterCallables[i]] = i;
+
+  std::vector<Item> beforeItems, afterItems;
+  flatten(before, beforeItems);
+  flatten(after, afterItems);
+
+  // Anything but a single <html> root is re-parsed by the browser into a different shape.
+  auto isDocument = [](const std::vector<Item>& items) { return items.size() == 1 && items[0].tag && *items[0].tag == "html"; };
+  if (!isDocument(beforeItems) || !isDocument(afterItems)) {
+    return "{\"reload\":true}";
+  }
+
+  diffElement(beforeItems[0], afterItems[0], context, true);
+  if (context.ops.empty()) {
+    return {};
+  }
+
+  return "{\"g\":" + std::to_string(generation) + ",\"ops\":[" + context.ops + "]}";
+}
+
+void Patch::flatten(const JSON& node, std::vector<Item>& items) {
+  auto appendText = [&](const std::string& text) {
+    if (text.empty()) return;
+    if (!items.empty() && !items.back().tag) {
+      items.back().text += text;
+    } else {
+      items.push_back(Item{nullptr, nullptr, text});
+    }
+  };
+
+  switch (node.type()) {
+    case JSON::Type::Null:
+    case JSON::Type::Callable:
+      break;
+    case JSON::Type::Boolean:
+      appendText(node.value<JSON::Boolean>() ? "true" : "false");
+      break;
+    case JSON::Type::Integer:
+      appendText(std::to_string(node.value<JSON::Integer>()));
+      break;
+    case JSON::Type::Floating:
+      appendText(node.stringify());
+      break;
+    case JSON::Type::String:
+      appendText(node.value<JSON::String>());
+      break;
+    case JSON::Type::Array:
+      for (const auto& child : node.value<JSON::Array>()) {
+        flatten(child, items);
+      }
+      break;
+    case JSON::Type::Object:
+      for (const auto& [tag, element] : node.value<JSON::Object>()) {
+        items.push_back(Item{&tag, &element, {}});
+      }
+      break;
+  }
+}
+
+const JSON* Patch::children(const Item& item) {
+  if (item.element->type() != JSON::Type::Object || Html::isVoidElement(*item.tag)) return nullptr;
+  for (const auto& [name, value] : item.element->value<JSON::Object>()) {
+    if (name == "children") return &value;
+  }
+  return nullptr;
+}
+
+std::optional<std::string> Patch::attribute(const JSON& value, const Ids& ids) {
+  switch (value.type()) {
+    case JSON::Type::Null:
+      return std::nullopt;
+    case JSON::Type::Callable: {
+      auto id = ids.find(&value.value<JSON::Callable>());
+      return id == ids.end() ? std::nullopt : std::optional<std::string>("cppx(" + std::to_string(id->second) + ")");
+    }
+    case JSON::Type::Boolean:
+      return value.value<JSON::Boolean>() ? std::optional<std::string>("") : std::nullopt;
+    case JSON::Type::Integer:
+      return std::to_string(value.value<JSON::Integer>());
+    case JSON::Type::Floating:
+      return value.stringify();
+    case JSON::Type::String:
+      return value.value<JSON::String>();
+    default:
+      return std::nullopt;
+  }
+}
+
+void Patch::attributes(const JSON& element, const Ids& ids, std::vector<std::pair<const std::string*, std::string>>& output) {
+  if (element.type() != JSON::Type::Object) return;
+  for (const auto& [name, value] : element.value<JSON::Object>()) {
+    if (name == "children") continue;
+    if (auto rendered = attribute(value, ids)) {
+      output.emplace_back(&name, std::move(*rendered));
+    }
+  }
+}
+
+void Patch::diffElement(const Item& before, const Item& after, Context& context, bool root) {
+  std::vector<std::pair<const std::string*, std::string>> beforeAttributes, afterAttributes;
+  attributes(*before.element, context.beforeIds, beforeAttributes);
+  attributes(*after.element, context.afterIds, afterAttributes);
+
+  auto find = [](const auto& list, const std::string& name) {
+    return std::find_if(list.begin(), list.end(), [&](const auto& entry) { return *entry.first == name; });
+  };
+
+  for (const auto& [name, value] : afterAttributes) {
+    auto previous = find(beforeAttributes, *name);
+    if (previous == beforeAttributes.end() || previous->second != value) {
+      beginOp(context, "attr");
+      context.ops += ",\"name\":";
+      writeString(*name, context.ops);
+      context.ops += ",\"value\":";
+      writeString(value, context.ops);
+      context.ops += '}';
+    }
+  }
+  for (const auto& [name, value] : beforeAttributes) {
+    if (find(afterAttributes, *name) == afterAttributes.end()) {
+      beginOp(context, "attr");
+      context.ops += ",\"name\":";
+      writeString(*name, context.ops);
+      context.ops += '}';
+    }
+  }
+
+  std::vector<Item> beforeChildren, afterChildren;
+  if (const JSON* node = children(before)) flatten(*node, beforeChildren);
+  if (const JSON* node = children(after)) flatten(*node, afterChildren);
+
+  bool sameShape = beforeChildren.size() == afterChildren.size();
+  for (size_t i = 0; sameShape && i < beforeChildren.size(); ++i) {
+    const Item& left = beforeChildren[i];
+    const Item& right = afterChildren[i];
+    sameShape = (!left.tag && !right.tag) || (left.tag && right.tag && *left.tag == *right.tag);
+  }
+
+  if (!sameShape) {
+    beginOp(context, "children");
+    context.ops += ",\"value\":[";
+    for (size_t i = 0; i < afterChildren.size(); ++i) {
+      if (i > 0) context.ops += ',';
+      writeNode(afterChildren[i], context.afterIds, context.ops);
+    }
+    context.ops += "]}";
+    return;
+  }
+
+  // Browsers always give <html> a <head>, inserting one when the page has none.
+  size_t offset = root && (afterChildren.empty() || !afterChildren[0].tag || *afterChildren[0].tag != "head") ? 1 : 0;
+
+  for (size_t i = 0; i < afterChildren.size(); ++i) {
+    context.path.push_back(i + offset);
+    if (!afterChildren[i].tag) {
+      if (beforeChildren[i].text != afterChildren[i].text) {
+        beginOp(context, "text");
+        context.ops += ",\"value\":";
+        writeString(afterChildren[i].text, context.ops);
+        context.ops += '}';
+      }
+    } else {
+      diffElement(beforeChildren[i], afterChildren[i], context);
+    }
+    context.path.pop_back();
+  }
+}
+
+void Patch::beginOp(Context& context, const char* op) {
+  if (!context.ops.empty()) context.ops += ',';
+  context.ops += "{\"op\":\"";
+  context.ops += op;
+  context.ops += "\",\"path\":[";
+  for (size_t i = 0; i < context.path.size(); ++i) {
+    if (i > 0) context.ops += ',';
+    context.ops += std::to_string(context.path[i]);
+  }
+  context.ops += ']';
+}
+
+void Patch::writeNode(const Item& item, const Ids& ids, std::string& output) {
+  if (!item.tag) {
+    writeString(item.text, output);
+    return;
+  }
+
+  output += "{\"t\":";
+  writeString(*item.tag, output);
+
+  output += ",\"a\":{";
+  std::vector<std::pair<const std::string*, std::string>> list;
+  attributes(*item.element, ids, list);
+  for (size_t i = 0; i < list.size(); ++i) {
+    if (i > 0) output += ',';
+    writeString(*list[i].first, output);
+    output += ':';
+    writeString(list[i].second, output);
+  }
+
+  output += "},\"c\":[";
+  std::vector<Item> items;
+  if (const JSON* node = children(item)) flatten(*node, items);
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (i > 0) output += ',';
+    writeNode(items[i], ids, output);
+  }
+  output += "]}";
+}
+
+void Patch::writeString(const std::string& text, std::string& output) {
+  static const char digits[] = "0123456789abcdef";
+
+  output += '"';
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        output += "\\\"";
+        break;
+      case '\\':
+        output += "\\\\";
+        break;
+      case '\n':
+        output += "\\n";
+        break;
+      case '\r':
+        output += "\\r";
+        break;
+      case '\t':
+        output += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          output += "\\u00";
+          output += digits[(c >> 4) & 0xF];
+          output += digits[c & 0xF];
+        } else {
+          output += c;
+        }
+    }
+  }
+  output += '"';
+}
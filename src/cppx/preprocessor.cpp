@@ -1,5 +1,12 @@
 #include "cppx/preprocessor.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stack>
+
 const std::unordered_set<std::string> Preprocessor::htmlTags = {
   "html", "head", "body", "title", "meta", "link", "script", "style",
   "h1", "h2", "h3", "h4", "h5", "h6", "p", "span", "div", "br", "hr",
@@ -19,10 +26,16 @@ const std::string Preprocessor::header = (
   "// WARNING: This file has been automatically generated or modified.\n"
   "// Any manual changes may be overwritten in future updates.\n"
   "\n"
+  "#include <iostream>\n"
+  "\n"
   "#include \"cppx/json.hpp\"\n"
   "#include \"cppx/page.hpp\"\n"
 );
 
+// Part of every preprocessor cache key. Bump it whenever Process or the builder's processFile changes what they write
+// for the same input, so that stale outputs are not reused.
+const std::string Preprocessor::version = "2";
+
 std::string Preprocessor::Trim(const std::string& str) {
   const std::string whitespace = " \n\r\t";
   size_t start = str.find_first_not_of(whitespace);
@@ -114,7 +127,7 @@ std::unordered_map<std::string, std::string> Preprocessor::ParseAttributes(const
   return attributes;
 }
 
-Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& pos) {
+Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& pos, std::ostream& diagnostics) {
   DOMNode node;
   if (html[pos] == '<') {
     size_t tagStart = pos;
@@ -162,7 +175,7 @@ Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& p
       node.type = "closing";
       node.tagName = tagName;
       pos = tagEnd + 1;
-      std::cout << "Encountered closing tag: </" << tagName << ">" << std::endl;
+      diagnostics << "Encountered closing tag: </" << tagName << ">" << std::endl;
       return node;
     } else {
       node.type = "element";
@@ -171,7 +184,7 @@ Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& p
       pos = tagEnd + 1;
 
       if (isSelfClosing) {
-        std::cout << "Encountered self-closing tag: <" << tagName << " />" << std::endl;
+        diagnostics << "Encountered self-closing tag: <" << tagName << " />" << std::endl;
         return node;
       }
 
@@ -188,7 +201,7 @@ Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& p
             std::transform(closingTagContent.begin(), closingTagContent.end(), closingTagContent.begin(), ::tolower);
             if (closingTagContent == tagName) {
               pos = closingTagEnd + 1;
-              std::cout << "Found matching closing tag: </" << tagName << ">" << std::endl;
+              diagnostics << "Found matching closing tag: </" << tagName << ">" << std::endl;
               break;
             } else {
               DOMNode textNode;
@@ -197,10 +210,10 @@ Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& p
               textNode.type = "text";
               textNode.textContent = html.substr(textStart, pos - textStart);
               node.children.push_back(textNode);
-              std::cout << "Added text node (mismatched closing tag): \"" << textNode.textContent << "\"" << std::endl;
+              diagnostics << "Added text node (mismatched closing tag): \"" << textNode.textContent << "\"" << std::endl;
             }
           } else {
-            DOMNode child = ParseHTML(html, pos);
+            DOMNode child = ParseHTML(html, pos, diagnostics);
             if (child.type != "closing") {
               node.children.push_back(child);
             }
@@ -217,7 +230,7 @@ Preprocessor::DOMNode Preprocessor::ParseHTML(const std::string& html, size_t& p
             textNode.type = "text";
             textNode.textContent = text;
             node.children.push_back(textNode);
-            std::cout << "Added text node: \"" << text << "\"" << std::endl;
+            diagnostics << "Added text node: \"" << text << "\"" << std::endl;
           }
         }
       }
@@ -327,7 +340,7 @@ std::string Preprocessor::CorrectIndentation(const std::string& code) {
   return formattedCode;
 }
 
-std::vector<std::string> Preprocessor::ExtractValidHtmlBlocks(const std::string& script) {
+std::vector<std::string> Preprocessor::ExtractValidHtmlBlocks(const std::string& script, std::ostream& diagnostics) {
   std::vector<std::string> validBlocks;
   std::stack<std::string> tagStack;
   std::regex tagRegex(R"(<(/?)(\w+)([^>]*)>)");
@@ -359,7 +372,7 @@ std::vector<std::string> Preprocessor::ExtractValidHtmlBlocks(const std::string&
         validBlocks.push_back(block);
         pos = blockEnd;
         tagStack.pop();
-        std::cout << "Extracted block for <" << tagName << ">" << std::endl;
+        diagnostics << "Extracted block for <" << tagName << ">" << std::endl;
       }
     }
   }
@@ -372,15 +385,22 @@ std::string Preprocessor::AddHeader(const std::string& script) {
 }
 
 std::string Preprocessor::Process(const std::string& input) {
+  std::ostringstream diagnostics;
+  std::string result = Process(input, diagnostics);
+  std::cout << diagnostics.str() << std::flush;
+  return result;
+}
+
+std::string Preprocessor::Process(const std::string& input, std::ostream& diagnostics) {
   std::string script = input;
 
-  std::vector<std::string> htmlBlocks = ExtractValidHtmlBlocks(script);
+  std::vector<std::string> htmlBlocks = ExtractValidHtmlBlocks(script, diagnostics);
 
   std::unordered_map<std::string, std::string> replacements;
 
   for (const auto& html : htmlBlocks) {
     size_t pos = 0;
-    DOMNode root = ParseHTML(html, pos);
+    DOMNode root = ParseHTML(html, pos, diagnostics);
     std::string jsonResult = GenerateJSON(root, 0);
     jsonResult = CorrectIndentation(jsonResult);
     replacements[html] = "\n" + jsonResult;
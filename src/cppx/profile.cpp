@@ -0,0 +1,347 @@
+#include "cppx/profile.hpp"
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// The compiler phases that -ftime-report times, in the order they run.
+constexpr std::array<const char*, 3> phaseNames = {"parse", "instantiate", "generate"};
+constexpr std::array<const char*, 3> phaseReportNames = {" phase parsing", " phase lang. deferred", " phase opt and generate"};
+
+struct Record {
+  const char* kind = "";
+  std::string name;
+  std::string command;
+  size_t worker = 0;
+  uint64_t start = 0;
+  uint64_t wall = 0;
+  uint64_t cpu = 0;
+  long peak = 0;
+  bool reported = false;
+  std::array<double, phaseNames.size()> phases{};
+  std::vector<std::string> headers;
+};
+
+std::mutex recordsMutex;
+std::vector<Record> records;
+
+#if defined(_WIN32)
+
+// Windows has no getrusage, so steps and commands there are profiled by wall time alone.
+uint64_t threadCpu() { return 0; }
+long processPeak() { return 0; }
+
+#else
+
+uint64_t micros(const timeval& time) { return static_cast<uint64_t>(time.tv_sec) * 1000000 + time.tv_usec; }
+
+uint64_t threadCpu() {
+  rusage usage{};
+#if defined(RUSAGE_THREAD)
+  getrusage(RUSAGE_THREAD, &usage);
+#else
+  getrusage(RUSAGE_SELF, &usage);
+#endif
+  return micros(usage.ru_utime) + micros(usage.ru_stime);
+}
+
+// getrusage reports peak memory in kilobytes on Linux and in bytes on macOS.
+long peakKilobytes(const rusage& usage) {
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+long processPeak() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return peakKilobytes(usage);
+}
+
+#endif
+
+void add(Record record) {
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  records.push_back(std::move(record));
+}
+
+const char* commandKind(const std::string& command) {
+  if (command.rfind("ar ", 0) == 0) return "archive";
+  if (command.rfind("g++ ", 0) != 0) return "command";
+  if (command.find(" -shared") != std::string::npos) return "page";
+  if (command.find("-x c++-header") != std::string::npos) return "precompile";
+  if (command.find(" -c ") != std::string::npos) return "compile";
+  return "link";
+}
+
+// A link is named by what it writes and everything else by its first quoted operand, so a compile is named by its source.
+std::string commandName(const std::string& command, const char* kind) {
+  std::string first;
+  for (size_t open = command.find('"'); open != std::string::npos; open = command.find('"', open + 1)) {
+    size_t close = command.find('"', open + 1);
+    if (close == std::string::npos) break;
+    std::string_view before = std::string_view(command).substr(0, open);
+    std::string operand = command.substr(open + 1, close - open - 1);
+    open = close;
+
+    bool output = before.size() >= 3 && before.substr(before.size() - 3) == "-o ";
+    if (output && std::string_view(kind) == "link") return operand;
+    bool option = output;
+    for (std::string_view flag : {"-I", "-L", "-MF ", "-include "}) {
+      option = option || (before.size() >= flag.size() && before.substr(before.size() - flag.size()) == flag);
+    }
+    if (!option && first.empty()) first = operand;
+  }
+  return first.empty() ? command.substr(0, 60) : first;
+}
+
+void writeEscaped(std::string_view text, std::ostream& output) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      output << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      output << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+    } else {
+      output << c;
+    }
+  }
+}
+
+}  // namespace
+
+Profile::Step::Step(const char* kind, std::string_view name) : kind_(kind) {
+  if (enabled()) {
+    name_ = name;
+    start_ = now();
+    cpu_ = threadCpu();
+  }
+}
+
+Profile::Step::~Step() {
+  if (!start_) {
+    return;
+  }
+  Record record;
+  record.kind = kind_;
+  record.name = std::move(name_);
+  record.start = start_;
+  record.wall = now() - start_;
+  record.cpu = threadCpu() - cpu_;
+  record.peak = processPeak();
+  add(std::move(record));
+}
+
+std::string Profile::instrument(const std::string& command) {
+  if (command.rfind("g++ ", 0) != 0 || std::string_view(commandKind(command)) == "link") {
+    return command;
+  }
+  return "g++ -ftime-report -H " + command.substr(4);
+}
+
+void Profile::command(const std::string& command, size_t worker, uint64_t start, uint64_t end, const struct rusage* usage, std::string& output) {
+  Record record;
+  record.kind = commandKind(command);
+  record.name = commandName(command, record.kind);
+  record.command = command;
+  record.worker = worker;
+  record.start = start;
+  record.wall = end - start;
+#if defined(_WIN32)
+  (void)usage;
+#else
+  if (usage) {
+    record.cpu = micros(usage->ru_utime) + micros(usage->ru_stime);
+    record.peak = peakKilobytes(*usage);
+  }
+#endif
+
+  // -H lists includes as dots for depth, "!" for a precompiled header it used and "x" for one it rejected, then
+  // names the headers that lack include guards. The report and the lists go to stderr with the diagnostics.
+  enum class Section { None, Report, Guards };
+  Section section = Section::None;
+  std::string kept;
+  size_t begin = 0;
+  while (begin < output.size()) {
+    size_t end = output.find('\n', begin);
+    if (end == std::string::npos) end = output.size();
+    std::string_view line = std::string_view(output).substr(begin, end - begin);
+    begin = end + 1;
+
+    if (section == Section::Report) {
+      for (size_t i = 0; i < phaseReportNames.size(); ++i) {
+        double user = 0, system = 0, wall = 0;
+        if (line.rfind(phaseReportNames[i], 0) == 0 &&
+            std::sscanf(std::string(line.substr(line.find(':') + 1)).c_str(), " %lf ( %*d%%) %lf ( %*d%%) %lf", &user, &system, &wall) == 3) {
+          record.phases[i] += wall;
+          record.reported = true;
+        }
+      }
+      if (line.rfind(" TOTAL", 0) == 0) section = Section::None;
+      continue;
+    }
+    if (section == Section::Guards) {
+      if (!line.empty() && line.find(':') == std::string_view::npos) continue;
+      section = Section::None;
+    }
+
+    if (line.empty()) continue;
+    if (line.rfind("Time variable", 0) == 0) {
+      section = Section::Report;
+      continue;
+    }
+    if (line == "Multiple include guards may be useful for:") {
+      section = Section::Guards;
+      continue;
+    }
+    size_t depth = line.find_first_not_of('.');
+    if (depth != std::string_view::npos && depth > 0 && line[depth] == ' ') {
+      if (depth == 1) record.headers.push_back(std::filesystem::path(line.substr(2)).lexically_normal().generic_string());
+      continue;
+    }
+    if (line.size() > 2 && (line[0] == '!' || line[0] == 'x') && line[1] == ' ') {
+      if (line[0] == '!') record.headers.push_back(std::filesystem::path(line.substr(2)).lexically_normal().generic_string());
+      continue;
+    }
+    kept.append(line).push_back('\n');
+  }
+  output = std::move(kept);
+  add(std::move(record));
+}
+
+bool Profile::write(const std::filesystem::path& path) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cerr << "Error: Cannot write profile to " << path << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  uint64_t origin = records.empty() ? 0 : records.front().start;
+  size_t workers = 0;
+  for (const auto& record : records) {
+    origin = std::min(origin, record.start);
+    workers = std::max(workers, record.worker + 1);
+  }
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t worker = 0; worker < workers; ++worker) {
+    file << (worker ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << worker << ",\"args\":{\"name\":\"job " << worker << "\"}}";
+  }
+  for (const auto& record : records) {
+    uint64_t start = record.start - origin;
+    file << ",\n{\"name\":\"";
+    writeEscaped(record.name, file);
+    file << "\",\"cat\":\"" << record.kind << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.worker << ",\"ts\":" << start << ",\"dur\":" << record.wall << ",\"args\":{\"cpu_ms\":" << record.cpu / 1000
+         << ",\"peak_kb\":" << record.peak;
+    if (!record.command.empty()) {
+      file << ",\"command\":\"";
+      writeEscaped(record.command, file);
+      file << "\"";
+    }
+    file << "}}";
+
+    // The compiler reports phase totals only, so they are laid end to end from the start of the step.
+    for (size_t i = 0; i < phaseNames.size(); ++i) {
+      auto duration = static_cast<uint64_t>(record.phases[i] * 1e6);
+      if (duration == 0) continue;
+      file << ",\n{\"name\":\"" << phaseNames[i] << "\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.worker << ",\"ts\":" << start << ",\"dur\":" << duration << "}";
+      start += duration;
+    }
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+void Profile::summarize(std::ostream& output) {
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  if (records.empty()) {
+    output << "Profile: no steps ran, everything was up to date." << std::endl;
+    return;
+  }
+
+  struct Total {
+    size_t steps = 0;
+    uint64_t wall = 0;
+    uint64_t cpu = 0;
+    double parse = 0;
+  };
+  Total all;
+  uint64_t first = records.front().start, last = 0;
+  long peak = 0;
+  std::map<std::string, Total> kinds;
+  std::map<std::string, Total> headers;
+  for (const auto& record : records) {
+    first = std::min(first, record.start);
+    last = std::max(last, record.start + record.wall);
+    peak = std::max(peak, record.peak);
+    for (Total* total : {&all, &kinds[record.kind]}) {
+      total->steps++;
+      total->wall += record.wall;
+      total->cpu += record.cpu;
+      total->parse += record.phases[0];
+    }
+    for (const auto& header : record.headers) {
+      headers[header].steps++;
+      headers[header].parse += record.phases[0];
+    }
+  }
+
+  auto seconds = [](uint64_t micros) { return static_cast<double>(micros) / 1e6; };
+  output << std::fixed << std::setprecision(2) << "Profile: " << all.steps << " steps in " << seconds(last - first) << " s, " << seconds(all.wall) << " s of step time, " << seconds(all.cpu)
+         << " s CPU, peak " << peak / 1024 << " MB\n";
+  for (const auto& [kind, total] : kinds) {
+    output << "  " << std::left << std::setw(12) << kind << std::right << std::setw(4) << total.steps << " steps " << std::setw(8) << seconds(total.wall) << " s " << std::setw(8) << seconds(total.cpu)
+           << " s CPU\n";
+  }
+
+  std::vector<const Record*> slowest;
+  for (const auto& record : records) {
+    slowest.push_back(&record);
+  }
+  std::sort(slowest.begin(), slowest.end(), [](const Record* a, const Record* b) { return a->wall > b->wall; });
+  slowest.resize(std::min(slowest.size(), summaryLength));
+
+  output << "Slowest steps:\n     wall      cpu     peak    parse instant. generate  step\n";
+  for (const Record* record : slowest) {
+    output << std::setw(7) << seconds(record->wall) << " s" << std::setw(7) << seconds(record->cpu) << " s" << std::setw(6) << record->peak / 1024 << " MB";
+    for (double phase : record->phases) {
+      if (record->reported) {
+        output << std::setw(7) << phase << " s";
+      } else {
+        output << std::setw(9) << "-";
+      }
+    }
+    output << "  " << record->kind << " " << record->name << "\n";
+  }
+
+  // A header is charged with the parse time of every step that includes it directly: what precompiling it could save at most.
+  std::vector<std::pair<std::string, Total>> ranked(headers.begin(), headers.end());
+  std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.second.parse > b.second.parse; });
+  ranked.resize(std::min(ranked.size(), summaryLength));
+  if (!ranked.empty()) {
+    output << "Headers by parse time of the steps that include them:\n    steps    parse  header\n";
+    for (const auto& [header, total] : ranked) {
+      output << std::setw(9) << total.steps << std::setw(7) << total.parse << " s  " << header << "\n";
+    }
+  }
+  output << std::defaultfloat << std::flush;
+}
+
+void Profile::clear() {
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  records.clear();
+}
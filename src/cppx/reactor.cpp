@@ -0,0 +1,188 @@
+#include "cppx/reactor.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <optional>
+#include <system_error>
+
+namespace {
+
+std::atomic<Reactor*> activeReactor{nullptr};
+
+}  // namespace
+
+Reactor::Reactor() {
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  readyFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || timerFd_ < 0 || readyFd_ < 0) {
+    int error = errno;
+    for (int fd : {epollFd_, timerFd_, readyFd_}) {
+      if (fd >= 0) close(fd);
+    }
+    throw std::system_error(error, std::generic_category(), "Cannot create reactor");
+  }
+
+  // Waiters are identified by address, so the reactor's own descriptors use the addresses of their members.
+  for (int* fd : {&timerFd_, &readyFd_}) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, *fd, &event);
+  }
+
+  blocking_ = std::thread([this] {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      jobsChanged_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+
+      auto job = std::move(jobs_.front());
+      jobs_.pop_front();
+      lock.unlock();
+      job.first();
+      lock.lock();
+
+      ready_.push_back(job.second);
+      uint64_t value = 1;
+      (void)!write(readyFd_, &value, sizeof(value));
+    }
+  });
+
+  Reactor* expected = nullptr;
+  activeReactor.compare_exchange_strong(expected, this);
+}
+
+Reactor::~Reactor() {
+  Reactor* expected = this;
+  activeReactor.compare_exchange_strong(expected, nullptr);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  jobsChanged_.notify_all();
+  blocking_.join();
+
+  for (int fd : {epollFd_, timerFd_, readyFd_}) {
+    close(fd);
+  }
+}
+
+Reactor* Reactor::active() { return activeReactor.load(); }
+
+Reactor::Waiter Reactor::capture(std::coroutine_handle<> handle) { return Waiter{handle, Router::current(), RenderCache::Recorder::current()}; }
+
+void Reactor::resume(const Waiter& waiter) {
+  std::optional<Router::Scope> scope;
+  if (waiter.match) {
+    scope.emplace(*waiter.match);
+  }
+  RenderCache::Recorder::Scope recording(waiter.recorder);
+  waiter.handle.resume();
+}
+
+void Reactor::sleep(std::chrono::steady_clock::duration duration, std::coroutine_handle<> handle) {
+  Clock::time_point deadline = Clock::now() + duration;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto timer = timers_.emplace(deadline, capture(handle));
+  if (timer == timers_.begin()) {
+    arm(deadline);
+  }
+}
+
+void Reactor::wait(int fd, uint32_t events, std::coroutine_handle<> handle) {
+  // The page may resume on the event loop before this returns, so nothing here touches its frame afterwards.
+  auto* waiter = new Waiter(capture(handle));
+  epoll_event event{};
+  event.events = events | EPOLLONESHOT;
+  event.data.ptr = waiter;
+  if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0 && (errno != EEXIST || epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event) < 0)) {
+    // Not pollable (a regular file, say): it is as ready as it will ever be.
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push_back(*waiter);
+    delete waiter;
+    uint64_t value = 1;
+    (void)!write(readyFd_, &value, sizeof(value));
+  }
+}
+
+void Reactor::offload(std::function<void()> work, std::coroutine_handle<> handle) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.emplace_back(std::move(work), capture(handle));
+  }
+  jobsChanged_.notify_one();
+}
+
+void Reactor::dispatch() {
+  // Drained completely: the io_uring loop's poll on this descriptor only fires again on a new wakeup.
+  epoll_event events[64];
+  int count = 0;
+  do {
+    count = epoll_wait(epollFd_, events, 64, 0);
+    for (int i = 0; i < count; ++i) {
+      dispatch(events[i].data.ptr);
+    }
+  } while (count == 64);
+}
+
+void Reactor::dispatch(void* data) {
+  if (data == &timerFd_) {
+    uint64_t expirations = 0;
+    (void)!read(timerFd_, &expirations, sizeof(expirations));
+
+    std::vector<Waiter> expired;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto now = Clock::now();
+      auto end = timers_.upper_bound(now);
+      for (auto timer = timers_.begin(); timer != end; ++timer) {
+        expired.push_back(timer->second);
+      }
+      timers_.erase(timers_.begin(), end);
+      if (!timers_.empty()) {
+        arm(timers_.begin()->first);
+      }
+    }
+    for (const auto& waiter : expired) {
+      resume(waiter);
+    }
+    return;
+  }
+
+  if (data == &readyFd_) {
+    uint64_t value = 0;
+    (void)!read(readyFd_, &value, sizeof(value));
+
+    std::vector<Waiter> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready.swap(ready_);
+    }
+    for (const auto& waiter : ready) {
+      resume(waiter);
+    }
+    return;
+  }
+
+  Waiter waiter = *static_cast<Waiter*>(data);
+  delete static_cast<Waiter*>(data);
+  resume(waiter);
+}
+
+void Reactor::arm(Clock::time_point deadline) {
+  auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+  itimerspec spec{};
+  // An all-zero value would disarm the timer instead.
+  spec.it_value.tv_sec = nanoseconds / 1000000000;
+  spec.it_value.tv_nsec = nanoseconds > 0 ? nanoseconds % 1000000000 : 1;
+  timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
@@ -0,0 +1,319 @@
+#include "cppx/render_cache.hpp"
+
+#include <future>
+#include <iostream>
+
+#include "cppx/epoch.hpp"
+
+namespace {
+
+thread_local RenderCache::Recorder* currentRecorder = nullptr;
+std::atomic<RenderCache*> activeCache{nullptr};
+
+constexpr auto touchInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds(1)).count();
+
+std::string keyedRoute(std::string_view route, const std::string& key) {
+  std::string result(route);
+  result += '\n';
+  result += key;
+  return result;
+}
+
+}  // namespace
+
+void cacheable() {
+  if (auto* recorder = RenderCache::Recorder::current()) recorder->cacheable = true;
+}
+
+void cacheKey(CacheKeyFunction function) {
+  if (auto* recorder = RenderCache::Recorder::current()) {
+    recorder->keyFunction = function;
+    recorder->cacheable = true;
+  }
+}
+
+void cacheFor(std::chrono::milliseconds timeToLive) {
+  if (auto* recorder = RenderCache::Recorder::current()) {
+    recorder->timeToLive = timeToLive;
+    recorder->cacheable = true;
+  }
+}
+
+void uncacheable() {
+  if (auto* recorder = RenderCache::Recorder::current()) recorder->dynamic = true;
+}
+
+Page deferred(Task<Page> content, Page fallback) {
+  auto* recorder = RenderCache::Recorder::current();
+  if (!recorder) {
+    // Nothing outside a server render would stream it, so it resolves here.
+    std::promise<void> finished;
+    content.start([&finished] { finished.set_value(); });
+    finished.get_future().wait();
+    return content.result();
+  }
+
+  recorder->dynamic = true;
+  std::string id = "cppx-deferred-" + std::to_string(recorder->deferred.size());
+  recorder->deferred.push_back(std::move(content));
+  return JSON{"cppx-deferred", {"id", id, "children", fallback}};
+}
+
+void invalidateCache(std::string_view route) {
+  RenderCache* cache = RenderCache::active();
+  if (!cache) {
+    return;
+  }
+  if (route.empty()) {
+    cache->clear();
+  } else {
+    cache->invalidate(route);
+  }
+}
+
+RenderCache::Recorder* RenderCache::Recorder::current() { return currentRecorder; }
+
+RenderCache::Recorder::Scope::Scope(Recorder* recorder) : previous_(currentRecorder) { currentRecorder = recorder; }
+
+RenderCache::Recorder::Scope::~Scope() { currentRecorder = previous_; }
+
+RenderCache::RenderCache() {
+  RenderCache* expected = nullptr;
+  activeCache.compare_exchange_strong(expected, this);
+}
+
+RenderCache::~RenderCache() {
+  RenderCache* expected = this;
+  activeCache.compare_exchange_strong(expected, nullptr);
+
+  for (auto& shard : shards_) {
+    for (auto& slot : shard.slots) {
+      const Entry* entry = slot.load();
+      if (entry && entry != &removed_) {
+        delete entry;
+      }
+    }
+  }
+}
+
+RenderCache* RenderCache::active() { return activeCache.load(); }
+
+RenderCache::Shard& RenderCache::shard(std::string_view route) { return shards_[Hash()(route) % shardCount]; }
+
+const RenderCache::Shard& RenderCache::shard(std::string_view route) const { return shards_[Hash()(route) % shardCount]; }
+
+const RenderCache::Entry* RenderCache::lookup(const Shard& shard, std::string_view key) const {
+  size_t hash = Hash()(key);
+  for (size_t i = 0, slot = hash / shardCount % slotCount; i < slotCount; ++i, slot = (slot + 1) % slotCount) {
+    const Entry* entry = shard.slots[slot].load(std::memory_order_acquire);
+    if (!entry) {
+      return nullptr;
+    }
+    if (entry != &removed_ && entry->hash == hash && entry->key == key) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+RenderCache::Body RenderCache::find(std::string_view route, Compression::Encoding encoding) const {
+  Epoch::Guard guard;
+  const Shard& shard = this->shard(route);
+  auto now = Clock::now();
+  // Recency is kept to the millisecond so that hits on a hot entry rarely write its cache line.
+  auto touch = [used = now.time_since_epoch().count()](const Entry* entry) {
+    if (used - entry->used.load(std::memory_order_relaxed) > touchInterval) {
+      entry->used.store(used, std::memory_order_relaxed);
+    }
+  };
+
+  const Entry* entry = lookup(shard, route);
+  if (!entry) {
+    return {};
+  }
+  touch(entry);
+
+  if (entry->keyFunction) {
+    entry = lookup(shard, keyedRoute(route, entry->keyFunction()));
+    if (!entry) {
+      return {};
+    }
+    touch(entry);
+  }
+
+  return now < entry->expires ? entry->bodies[static_cast<int>(encoding)] : Body();
+}
+
+RenderCache::Body RenderCache::store(std::string_view route, const Recorder& recorder, std::string body, Compression::Encoding encoding) {
+  if (!recorder.caches()) {
+    return {};
+  }
+
+  // Compressed once at the best level, then served from memory with no further CPU cost.
+  auto entry = std::make_unique<Entry>();
+  auto& bodies = entry->bodies;
+  bodies[static_cast<int>(Compression::Encoding::Gzip)].data = std::make_shared<const std::string>(Compression::compress(body, Compression::Encoding::Gzip, Compression::bestLevel));
+  bodies[static_cast<int>(Compression::Encoding::Deflate)].data = std::make_shared<const std::string>(Compression::compress(body, Compression::Encoding::Deflate, Compression::bestLevel));
+  bodies[static_cast<int>(Compression::Encoding::Identity)].data = std::make_shared<const std::string>(std::move(body));
+  if (recorder.timeToLive.count() > 0) {
+    entry->expires = Clock::now() + recorder.timeToLive;
+  }
+
+  if (!recorder.keyFunction && recorder.timeToLive.count() == 0) {
+    for (auto& stored : bodies) {
+      if (stored.data->size() >= minFileSize) {
+        try {
+          stored.file = ResponseFile::create(*stored.data);
+        } catch (const std::exception& error) {
+          std::cerr << "Error: Caching " << route << " in a file failed: " << error.what() << std::endl;
+        }
+      }
+    }
+  }
+  Body stored = bodies[static_cast<int>(encoding)];
+
+  entry->key = recorder.keyFunction ? keyedRoute(route, recorder.keyFunction()) : std::string(route);
+  for (const auto& cached : bodies) {
+    entry->bytes += cached.data->size();
+  }
+  // A body too large for its shard is served but not kept.
+  if (entry->bytes > maxBytes / shardCount) {
+    return stored;
+  }
+
+  entry->hash = Hash()(entry->key);
+  entry->used = Clock::now().time_since_epoch().count();
+
+  std::unique_ptr<Entry> index;
+  if (recorder.keyFunction) {
+    index = std::make_unique<Entry>();
+    index->key = std::string(route);
+    index->hash = Hash()(index->key);
+    index->used = entry->used.load();
+    index->keyFunction = recorder.keyFunction;
+  }
+
+  Shard& shard = this->shard(route);
+  std::vector<const Entry*> retired;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (index) {
+      place(shard, index.release(), retired);
+    }
+    place(shard, entry.release(), retired);
+  }
+  retire(std::move(retired));
+  return stored;
+}
+
+void RenderCache::invalidate(std::string_view route) {
+  Shard& shard = this->shard(route);
+  std::vector<const Entry*> retired;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (size_t slot = 0; slot < slotCount; ++slot) {
+      const Entry* entry = shard.slots[slot].load(std::memory_order_relaxed);
+      if (!entry || entry == &removed_) {
+        continue;
+      }
+      const std::string& key = entry->key;
+      if (key.compare(0, route.size(), route) == 0 && (key.size() == route.size() || key[route.size()] == '\n')) {
+        remove(shard, slot, retired);
+      }
+    }
+  }
+  retire(std::move(retired));
+}
+
+void RenderCache::clear() {
+  for (auto& shard : shards_) {
+    std::vector<const Entry*> retired;
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (size_t slot = 0; slot < slotCount; ++slot) {
+        const Entry* entry = shard.slots[slot].load(std::memory_order_relaxed);
+        if (entry && entry != &removed_) {
+          remove(shard, slot, retired);
+        }
+      }
+    }
+    retire(std::move(retired));
+  }
+}
+
+void RenderCache::place(Shard& shard, const Entry* entry, std::vector<const Entry*>& retired) {
+  size_t start = entry->hash / shardCount % slotCount;
+  for (size_t i = 0, slot = start; i < slotCount; ++i, slot = (slot + 1) % slotCount) {
+    const Entry* existing = shard.slots[slot].load(std::memory_order_relaxed);
+    if (!existing) {
+      break;
+    }
+    if (existing != &removed_ && existing->hash == entry->hash && existing->key == entry->key) {
+      shard.bytes += entry->bytes - existing->bytes;
+      shard.slots[slot].store(entry, std::memory_order_release);
+      retired.push_back(existing);
+      while (shard.bytes > maxBytes / shardCount) {
+        evict(shard, retired);
+      }
+      return;
+    }
+  }
+
+  while (shard.entries > 0 && (shard.entries >= slotCount / 2 || shard.bytes + entry->bytes > maxBytes / shardCount)) {
+    evict(shard, retired);
+  }
+  for (size_t i = 0, slot = start; i < slotCount; ++i, slot = (slot + 1) % slotCount) {
+    const Entry* existing = shard.slots[slot].load(std::memory_order_relaxed);
+    if (!existing || existing == &removed_) {
+      shard.slots[slot].store(entry, std::memory_order_release);
+      shard.entries++;
+      shard.bytes += entry->bytes;
+      return;
+    }
+  }
+}
+
+void RenderCache::remove(Shard& shard, size_t slot, std::vector<const Entry*>& retired) {
+  const Entry* entry = shard.slots[slot].load(std::memory_order_relaxed);
+  shard.entries--;
+  shard.bytes -= entry->bytes;
+  shard.slots[slot].store(&removed_, std::memory_order_release);
+  retired.push_back(entry);
+
+  // No probe passes an empty slot, so markers right before one are not needed to reach anything.
+  while (shard.slots[slot].load(std::memory_order_relaxed) == &removed_ && !shard.slots[(slot + 1) % slotCount].load(std::memory_order_relaxed)) {
+    shard.slots[slot].store(nullptr, std::memory_order_release);
+    slot = (slot + slotCount - 1) % slotCount;
+  }
+}
+
+void RenderCache::evict(Shard& shard, std::vector<const Entry*>& retired) {
+  auto now = Clock::now();
+  size_t victim = slotCount;
+  for (size_t slot = 0; slot < slotCount; ++slot) {
+    const Entry* entry = shard.slots[slot].load(std::memory_order_relaxed);
+    if (!entry || entry == &removed_) {
+      continue;
+    }
+    if (now >= entry->expires) {
+      victim = slot;
+      break;
+    }
+    if (victim == slotCount || entry->used.load(std::memory_order_relaxed) < shard.slots[victim].load(std::memory_order_relaxed)->used.load(std::memory_order_relaxed)) {
+      victim = slot;
+    }
+  }
+  remove(shard, victim, retired);
+}
+
+void RenderCache::retire(std::vector<const Entry*> retired) {
+  if (retired.empty()) {
+    return;
+  }
+  Epoch::retire([retired = std::move(retired)] {
+    for (const Entry* entry : retired) {
+      delete entry;
+    }
+  });
+  Epoch::collect();
+}
@@ -0,0 +1,142 @@
+#include "cppx/response_writer.hpp"
+
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+ResponseFile::~ResponseFile() { std::fclose(file_); }
+
+std::shared_ptr<const ResponseFile> ResponseFile::create(std::string_view content) {
+  std::FILE* file = std::tmpfile();
+  if (!file) {
+    throw std::runtime_error("Cannot create response file");
+  }
+
+  if (std::fwrite(content.data(), 1, content.size(), file) != content.size() || std::fflush(file) != 0) {
+    std::fclose(file);
+    throw std::runtime_error("Cannot write response file");
+  }
+
+  return std::shared_ptr<const ResponseFile>(new ResponseFile(file, content.size()));
+}
+
+int ResponseFile::fd() const { return fileno(file_); }
+
+void ResponseWriter::append(std::string data) {
+  if (data.empty()) {
+    return;
+  }
+
+  size_ += data.size();
+  Slice& slice = slices_.emplace_back();
+  slice.owned = std::move(data);
+}
+
+void ResponseWriter::appendView(std::string_view data, std::shared_ptr<const void> owner) {
+  if (data.empty()) {
+    return;
+  }
+
+  size_ += data.size();
+  Slice& slice = slices_.emplace_back();
+  slice.view = data;
+  slice.owner = std::move(owner);
+}
+
+void ResponseWriter::appendFile(std::shared_ptr<const ResponseFile> file) {
+  if (file->size() == 0) {
+    return;
+  }
+
+  size_ += file->size();
+  Slice& slice = slices_.emplace_back();
+  slice.file = std::move(file);
+}
+
+void ResponseWriter::append(ResponseWriter&& other) {
+  if (slices_.empty()) {
+    slices_.swap(other.slices_);
+    offset_ = other.offset_;
+  } else {
+    // A partially written writer is only ever the destination, so other starts at its first byte.
+    for (auto& slice : other.slices_) {
+      slices_.push_back(std::move(slice));
+    }
+  }
+
+  size_ += other.size_;
+  other.clear();
+}
+
+ResponseWriter::Result ResponseWriter::flush(int fd) {
+  while (!slices_.empty()) {
+    ssize_t sent = 0;
+
+    if (const auto& file = slices_.front().file) {
+#if defined(__linux__)
+      off_t offset = static_cast<off_t>(offset_);
+      sent = sendfile(fd, file->fd(), &offset, file->size() - offset_);
+#else
+      char buffer[64 * 1024];
+      sent = pread(file->fd(), buffer, std::min(sizeof(buffer), file->size() - offset_), static_cast<off_t>(offset_));
+      if (sent > 0) sent = ::write(fd, buffer, static_cast<size_t>(sent));
+#endif
+    } else {
+      iovec vectors[maxVectors];
+      sent = writev(fd, vectors, gather(vectors, maxVectors));
+    }
+
+    if (sent > 0) {
+      consume(static_cast<size_t>(sent));
+      continue;
+    }
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return Result::Blocked;
+    }
+    return Result::Failed;
+  }
+
+  return Result::Complete;
+}
+
+int ResponseWriter::gather(iovec* vectors, int count) const {
+  int gathered = 0;
+  for (auto slice = slices_.begin(); slice != slices_.end() && gathered < count && !slice->file; ++slice) {
+    std::string_view data = slice->data();
+    if (gathered == 0) data.remove_prefix(offset_);
+    vectors[gathered].iov_base = const_cast<char*>(data.data());
+    vectors[gathered].iov_len = data.size();
+    ++gathered;
+  }
+  return gathered;
+}
+
+void ResponseWriter::clear() {
+  slices_.clear();
+  offset_ = 0;
+  size_ = 0;
+}
+
+void ResponseWriter::consume(size_t bytes) {
+  size_ -= bytes;
+  while (bytes > 0) {
+    size_t remaining = slices_.front().size() - offset_;
+    if (bytes < remaining) {
+      offset_ += bytes;
+      return;
+    }
+    bytes -= remaining;
+    offset_ = 0;
+    slices_.pop_front();
+  }
+}
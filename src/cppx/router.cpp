@@ -0,0 +1,238 @@
+#include "cppx/router.hpp"
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#include "cppx/trace.hpp"
+
+namespace {
+
+thread_local const Router::Match* currentMatch = nullptr;
+
+bool isDynamicSegment(std::string_view segment) {
+  return segment.size() > 2 && segment.front() == '[' && segment.back() == ']';
+}
+
+}  // namespace
+
+std::string_view routeParam(std::string_view name) {
+  const Router::Match* match = Router::current();
+  return match ? match->param(name) : std::string_view();
+}
+
+std::string_view Router::Match::param(std::string_view name) const {
+  for (size_t i = 0; i < paramCount; ++i) {
+    if (params[i].first == name) {
+      return params[i].second;
+    }
+  }
+  return {};
+}
+
+Router::Scope::Scope(const Match& match) : previous_(currentMatch) { currentMatch = &match; }
+
+Router::Scope::~Scope() { currentMatch = previous_; }
+
+const Router::Match* Router::current() { return currentMatch; }
+
+Router::Router() : root_(std::make_unique<Node>()) {}
+
+Router::~Router() = default;
+
+Router::Library::~Library() {
+  if (handle) {
+    dlclose(handle);
+  }
+}
+
+std::string_view Router::nextSegment(std::string_view& path) {
+  while (!path.empty() && path.front() == '/') path.remove_prefix(1);
+  size_t slash = path.find('/');
+  std::string_view segment = path.substr(0, slash);
+  path.remove_prefix(slash == std::string_view::npos ? path.size() : slash);
+  return segment;
+}
+
+bool Router::add(std::string_view route, PageFunction page, std::shared_ptr<const void> library) {
+  Node* node = insert(route);
+  if (!node) {
+    return false;
+  }
+  node->page = page;
+  node->asyncPage = nullptr;
+  node->library = std::move(library);
+  return true;
+}
+
+bool Router::add(std::string_view route, AsyncPageFunction page, std::shared_ptr<const void> library) {
+  Node* node = insert(route);
+  if (!node) {
+    return false;
+  }
+  node->page = nullptr;
+  node->asyncPage = page;
+  node->library = std::move(library);
+  return true;
+}
+
+Router::Node* Router::insert(std::string_view route) {
+  std::string name = route.substr(0, 1) == "/" ? "" : "/";
+  name += route;
+  Node* node = root_.get();
+
+  for (std::string_view segment = nextSegment(route); !segment.empty(); segment = nextSegment(route)) {
+    if (isDynamicSegment(segment)) {
+      std::string_view paramName = segment.substr(1, segment.size() - 2);
+      if (!node->dynamic) {
+        node->dynamic = std::make_unique<Node>();
+        node->dynamic->paramName = std::string(paramName);
+      } else if (node->dynamic->paramName != paramName) {
+        std::cerr << "Error: Route " << name << " conflicts with [" << node->dynamic->paramName << "] at the same position in another route" << std::endl;
+        return nullptr;
+      }
+      node = node->dynamic.get();
+      continue;
+    }
+
+    auto child = std::lower_bound(node->children.begin(), node->children.end(), segment, [](const auto& entry, std::string_view key) { return entry.first < key; });
+    if (child == node->children.end() || child->first != segment) {
+      child = node->children.emplace(child, std::string(segment), std::make_unique<Node>());
+    }
+    node = child->second.get();
+  }
+
+  node->route = std::move(name);
+  return node;
+}
+
+std::shared_ptr<Router::Library> Router::load(const std::filesystem::path& source) {
+  static std::atomic<uint64_t> version{0};
+  std::error_code error;
+
+  auto library = std::make_shared<Library>();
+  library->source = source;
+  library->modified = std::filesystem::last_write_time(source, error);
+  library->size = std::filesystem::file_size(source, error);
+  if (error) {
+    return nullptr;
+  }
+
+  // dlopen caches objects by path, so every build is loaded from its own copy.
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / ("cppx-" + std::to_string(getpid()));
+  std::filesystem::path copy = directory / (std::to_string(version++) + ".so");
+  std::filesystem::create_directories(directory, error);
+  if (!std::filesystem::copy_file(source, copy, std::filesystem::copy_options::overwrite_existing, error)) {
+    std::cerr << "Error: Cannot copy " << source << ": " << error.message() << std::endl;
+    return nullptr;
+  }
+
+  {
+    Trace::Span span("dlopen", source.native());
+    library->handle = dlopen(copy.c_str(), RTLD_NOW | RTLD_LOCAL);
+  }
+  std::filesystem::remove(copy, error);
+  std::filesystem::remove(directory, error);
+  if (!library->handle) {
+    std::cerr << "Error: Cannot load " << source << ": " << dlerror() << std::endl;
+    return nullptr;
+  }
+
+  using GetPageFunction = PageFunction (*)();
+  using GetAsyncPageFunction = AsyncPageFunction (*)();
+  if (auto getPageFunction = reinterpret_cast<GetPageFunction>(dlsym(library->handle, "getPageFunction"))) {
+    library->page = getPageFunction();
+  } else if (auto getAsyncPageFunction = reinterpret_cast<GetAsyncPageFunction>(dlsym(library->handle, "getAsyncPageFunction"))) {
+    library->asyncPage = getAsyncPageFunction();
+  } else {
+    std::cerr << "Error: " << source << " exports neither getPageFunction nor getAsyncPageFunction" << std::endl;
+    return nullptr;
+  }
+
+  return library;
+}
+
+size_t Router::scan(const std::filesystem::path& directory, const Router* previous) {
+  size_t loaded = 0;
+  std::error_code error;
+
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+    if (!entry.is_regular_file() || entry.path().filename() != "page.so") {
+      continue;
+    }
+
+    std::shared_ptr<Library> existing;
+    if (previous) {
+      auto found = std::find_if(previous->libraries_.begin(), previous->libraries_.end(), [&](const auto& library) { return library->source == entry.path(); });
+      if (found != previous->libraries_.end()) {
+        existing = *found;
+      }
+    }
+
+    std::shared_ptr<Library> library;
+    if (existing && existing->modified == entry.last_write_time(error) && existing->size == entry.file_size(error)) {
+      library = existing;
+    } else {
+      library = load(entry.path());
+      if (!library) {
+        // A page that is still being linked keeps serving its last good build.
+        library = existing;
+      } else if (existing) {
+        std::cout << "Reloaded " << entry.path().string() << std::endl;
+      }
+    }
+    if (!library) {
+      continue;
+    }
+
+    std::string route = std::filesystem::relative(entry.path().parent_path(), directory).generic_string();
+    bool added = library->asyncPage ? add(route == "." ? "" : route, library->asyncPage, library) : add(route == "." ? "" : route, library->page, library);
+    if (!added) {
+      continue;
+    }
+    libraries_.push_back(library);
+    loaded++;
+  }
+
+  return loaded;
+}
+
+bool Router::match(std::string_view path, Match& match) const {
+  match.page = nullptr;
+  match.asyncPage = nullptr;
+  match.route = {};
+  match.paramCount = 0;
+  match.library = nullptr;
+  return matchNode(*root_, path, match);
+}
+
+bool Router::matchNode(const Node& node, std::string_view path, Match& match) {
+  std::string_view segment = nextSegment(path);
+
+  if (segment.empty()) {
+    match.page = node.page;
+    match.asyncPage = node.asyncPage;
+    match.route = node.route;
+    match.library = &node.library;
+    return node.page != nullptr || node.asyncPage != nullptr;
+  }
+
+  auto child = std::lower_bound(node.children.begin(), node.children.end(), segment, [](const auto& entry, std::string_view key) { return entry.first < key; });
+  if (child != node.children.end() && child->first == segment && matchNode(*child->second, path, match)) {
+    return true;
+  }
+
+  if (node.dynamic && match.paramCount < maxParams) {
+    size_t paramCount = match.paramCount;
+    match.params[match.paramCount++] = {node.dynamic->paramName, segment};
+    if (matchNode(*node.dynamic, path, match)) {
+      return true;
+    }
+    match.paramCount = paramCount;
+  }
+
+  return false;
+}
@@ -0,0 +1,263 @@
+#include "cppx/scheduler.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "cppx/profile.hpp"
+#include "cppx/trace.hpp"
+
+#if !defined(_WIN32)
+extern char** environ;
+#endif
+
+Scheduler::Scheduler(size_t jobs) : jobs_(jobs == 0 ? 1 : jobs) {}
+
+size_t Scheduler::defaultJobs() {
+  unsigned int cores = std::thread::hardware_concurrency();
+  return cores == 0 ? 1 : cores;
+}
+
+size_t Scheduler::parseJobs(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    std::string value;
+
+    if ((argument == "-j" || argument == "--jobs") && i + 1 < argc) {
+      value = argv[++i];
+    } else if (argument.rfind("-j", 0) == 0 && argument.size() > 2) {
+      value = argument.substr(2);
+    } else if (argument.rfind("--jobs=", 0) == 0) {
+      value = argument.substr(7);
+    } else {
+      continue;
+    }
+
+    try {
+      size_t jobs = std::stoul(value);
+      if (jobs > 0) {
+        return jobs;
+      }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Error: Invalid job count " << value << ", using " << defaultJobs() << std::endl;
+  }
+
+  return defaultJobs();
+}
+
+Scheduler::JobId Scheduler::add(const std::string& command, const std::string& errorMessage, const std::vector<JobId>& dependencies, std::function<bool()> upToDate, std::function<void()> onSuccess) {
+  JobId id = queue_.size();
+  Job job;
+  job.command = command;
+  job.errorMessage = errorMessage;
+  job.upToDate = std::move(upToDate);
+  job.onSuccess = std::move(onSuccess);
+
+  for (JobId dependency : dependencies) {
+    if (dependency < id) {
+      queue_[dependency].dependents.push_back(id);
+      job.pendingDependencies++;
+    }
+  }
+
+  queue_.push_back(std::move(job));
+  return id;
+}
+
+bool Scheduler::run() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unfinished_ = 0;
+    failed_ = false;
+    for (JobId id = 0; id < queue_.size(); ++id) {
+      if (queue_[id].state != State::Waiting) continue;
+      unfinished_++;
+      if (queue_[id].pendingDependencies == 0) {
+        queue_[id].state = State::Ready;
+        ready_.push_back(id);
+      }
+    }
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < std::min(jobs_, unfinished_); ++i) {
+    workers.emplace_back(&Scheduler::worker, this, i);
+  }
+  worker(0);
+
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  return !failed_;
+}
+
+void Scheduler::worker(size_t index) {
+  while (true) {
+    JobId id;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return !ready_.empty() || unfinished_ == 0; });
+      if (ready_.empty()) {
+        return;
+      }
+      id = ready_.front();
+      ready_.pop_front();
+      queue_[id].state = State::Running;
+    }
+
+    Job& job = queue_[id];
+    if (job.upToDate && job.upToDate()) {
+      finish(id, true, "");
+      continue;
+    }
+
+    std::string output;
+    int status = 0;
+    {
+      Trace::Span span("command", job.command);
+      if (Profile::enabled()) {
+        uint64_t start = Profile::now();
+#if defined(_WIN32)
+        status = execute(Profile::instrument(job.command), output);
+        Profile::command(job.command, index, start, Profile::now(), nullptr, output);
+#else
+        rusage usage{};
+        status = execute(Profile::instrument(job.command), output, &usage);
+        Profile::command(job.command, index, start, Profile::now(), &usage, output);
+#endif
+      } else {
+        status = execute(job.command, output);
+      }
+    }
+    if (status == 0 && job.onSuccess) {
+      job.onSuccess();
+    }
+    finish(id, status == 0, output);
+  }
+}
+
+void Scheduler::finish(JobId id, bool succeeded, const std::string& output) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Job& job = queue_[id];
+  job.state = succeeded ? State::Succeeded : State::Failed;
+  unfinished_--;
+
+  if (!output.empty()) {
+    (succeeded ? std::cout : std::cerr) << output << std::flush;
+  }
+
+  if (succeeded) {
+    for (JobId dependent : job.dependents) {
+      Job& next = queue_[dependent];
+      if (--next.pendingDependencies == 0 && next.state == State::Waiting) {
+        if (failed_) {
+          skip(dependent);
+        } else {
+          next.state = State::Ready;
+          ready_.push_back(dependent);
+        }
+      }
+    }
+  } else {
+    std::cerr << "Error: " << job.errorMessage << std::endl;
+    failed_ = true;
+    for (JobId dependent : job.dependents) {
+      skip(dependent);
+    }
+    for (JobId pending : ready_) {
+      skip(pending);
+    }
+    ready_.clear();
+  }
+
+  condition_.notify_all();
+}
+
+void Scheduler::skip(JobId id) {
+  Job& job = queue_[id];
+  if (job.state != State::Waiting && job.state != State::Ready) return;
+  job.state = State::Skipped;
+  unfinished_--;
+  for (JobId dependent : job.dependents) {
+    skip(dependent);
+  }
+}
+
+#if defined(_WIN32)
+
+// Windows has neither posix_spawn nor wait4, so commands run through popen there and report no usage.
+int Scheduler::execute(const std::string& command, std::string& output, struct rusage*) {
+  std::string redirected = command + " 2>&1";
+  FILE* pipe = popen(redirected.c_str(), "r");
+  if (!pipe) {
+    output = "Error: Failed to start " + command + "\n";
+    return -1;
+  }
+
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+    output.append(buffer, count);
+  }
+
+  return pclose(pipe);
+}
+
+#else
+
+// Spawned rather than run through popen so that wait4 can report what the command and the processes it waited for used.
+int Scheduler::execute(const std::string& command, std::string& output, struct rusage* usage) {
+  int pipe[2];
+#if defined(__linux__)
+  bool opened = pipe2(pipe, O_CLOEXEC) == 0;
+#else
+  bool opened = ::pipe(pipe) == 0 && fcntl(pipe[0], F_SETFD, FD_CLOEXEC) == 0 && fcntl(pipe[1], F_SETFD, FD_CLOEXEC) == 0;
+#endif
+  if (!opened) {
+    output = "Error: Failed to start " + command + "\n";
+    return -1;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipe[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, pipe[1], STDERR_FILENO);
+  const char* arguments[] = {"sh", "-c", command.c_str(), nullptr};
+  pid_t pid = -1;
+  int error = posix_spawn(&pid, "/bin/sh", &actions, nullptr, const_cast<char* const*>(arguments), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipe[1]);
+  if (error != 0) {
+    close(pipe[0]);
+    output = "Error: Failed to start " + command + "\n";
+    return -1;
+  }
+
+  char buffer[4096];
+  ssize_t count;
+  while ((count = read(pipe[0], buffer, sizeof(buffer))) > 0 || (count < 0 && errno == EINTR)) {
+    if (count > 0) output.append(buffer, count);
+  }
+  close(pipe[0]);
+
+  int status = 0;
+  while (wait4(pid, &status, 0, usage) < 0) {
+    if (errno != EINTR) return -1;
+  }
+  return status;
+}
+
+#endif
@@ -0,0 +1,1574 @@
+#include "cppx/server.hpp"
+
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <iostream>
+
+#include "cppx/epoch.hpp"
+#include "cppx/html.hpp"
+#include "cppx/patch.hpp"
+#include "cppx/render_cache.hpp"
+#include "cppx/supervisor.hpp"
+#include "cppx/trace.hpp"
+#include "cppx/websocket.hpp"
+
+namespace {
+
+void failed(const HttpRequest& request, HttpResponse& response, const std::exception& error) {
+  std::cerr << "Error: Rendering " << request.path << " failed: " << error.what() << std::endl;
+  response.status = 500;
+  response.contentType = "text/plain; charset=utf-8";
+  response.body = "500 Internal Server Error";
+}
+
+// Puts resolved deferred content where deferred() left its placeholders; content that failed keeps its fallback.
+void splice(JSON& node, std::vector<std::optional<Page>>& contents) {
+  if (node.type() == JSON::Type::Array) {
+    for (size_t i = 0; i < node.value<JSON::Array>().size(); ++i) {
+      splice(node[i], contents);
+    }
+    return;
+  }
+  if (node.type() != JSON::Type::Object) {
+    return;
+  }
+
+  const auto& object = node.value<JSON::Object>();
+  if (object.size() == 1 && object.front().first == "cppx-deferred") {
+    std::string_view id = std::as_const(object.front().second)["id"].value<JSON::String>();
+    size_t index = 0;
+    std::from_chars(id.data() + id.rfind('-') + 1, id.data() + id.size(), index);
+    if (index < contents.size() && contents[index]) {
+      node = std::move(*contents[index]);
+      contents[index].reset();
+      return;
+    }
+  }
+
+  std::vector<std::string> tagNames;
+  for (const auto& [tagName, element] : object) {
+    if (element.type() == JSON::Type::Object) {
+      const auto& attributes = element.value<JSON::Object>();
+      if (std::any_of(attributes.begin(), attributes.end(), [](const auto& attribute) { return attribute.first == "children"; })) {
+        tagNames.emplace_back(tagName);
+      }
+    }
+  }
+  for (const auto& tagName : tagNames) {
+    splice(node[tagName]["children"], contents);
+  }
+}
+
+}  // namespace
+
+ServerOptions ServerOptions::parse(int argc, char* argv[]) {
+  ServerOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "-p" || argument == "--port") && i + 1 < argc) {
+      options.port = static_cast<uint16_t>(std::stoi(argv[++i]));
+    } else if (argument == "--host" && i + 1 < argc) {
+      options.host = argv[++i];
+    } else if ((argument == "-t" || argument == "--threads") && i + 1 < argc) {
+      options.threads = static_cast<size_t>(std::stoul(argv[++i]));
+    } else if (argument == "--pin") {
+      options.pinThreads = true;
+    } else if (argument == "--compression-level" && i + 1 < argc) {
+      options.compressionLevel = std::stoi(argv[++i]);
+    } else if (argument == "--no-cache") {
+      options.renderCache = false;
+    } else if ((argument == "-w" || argument == "--workers") && i + 1 < argc) {
+      options.workers = static_cast<size_t>(std::stoul(argv[++i]));
+    } else if (argument == "--trace" && i + 1 < argc) {
+      options.traceFile = argv[++i];
+    } else if (argument == "--metrics") {
+      options.metrics = true;
+    } else if (argument == "--max-sessions" && i + 1 < argc) {
+      options.maxSessions = static_cast<size_t>(std::stoul(argv[++i]));
+    } else if (argument == "--io-uring") {
+      options.ioUring = true;
+    } else if (argument == "--no-reload") {
+      options.hotReload = false;
+    }
+  }
+
+  return options;
+}
+
+Server::Server(ServerOptions options) : options_(std::move(options)), sessions_(Sessions::defaultTimeToLive, options_.maxSessions) {
+  if (!options_.traceFile.empty()) {
+    Trace::enableSpans();
+  }
+  if (options_.metrics) {
+    Trace::enableMetrics();
+  }
+  reload();
+}
+
+Server::~Server() {
+  pool_.reset();
+  reactor_.reset();
+  ring_.reset();
+  if (!options_.traceFile.empty()) {
+    Trace::write(options_.traceFile);
+  }
+  if (reloader_.joinable()) {
+    watcher_->interrupt();
+    reloader_.join();
+  }
+  Epoch::retire([router = router_.exchange(nullptr)] { delete router; });
+  Epoch::collect();
+
+  for (const auto& [fd, connection] : connections_) {
+    ::close(fd);
+  }
+  for (int fd : {epollFd_, listenFd_, signalFd_, stopFd_, wakeFd_, timerFd_}) {
+    if (fd >= 0) ::close(fd);
+  }
+}
+
+void Server::reload() {
+  Trace::Span span("reload");
+  Trace::count(Trace::Counter::Reloads);
+  auto router = std::make_unique<Router>();
+  const Router* previous = router_.load();
+
+  if (!options_.routerDirectory.empty()) {
+    router->scan(options_.routerDirectory, previous);
+  }
+  for (const auto& [route, pageFunction] : options_.routes) {
+    router->add(route, pageFunction);
+  }
+  for (const auto& [route, pageFunction] : options_.asyncRoutes) {
+    router->add(route, pageFunction);
+  }
+
+  // Requests that already matched against the previous table keep it, and its libraries, until they finish.
+  previous = router_.exchange(router.release());
+  cache_.clear();
+  if (previous) {
+    Epoch::retire([previous] { delete previous; });
+  }
+}
+
+bool Server::listen() {
+  listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    std::cerr << "Error: Cannot create socket: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  int enable = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  // Each worker listens on its own socket, and the kernel spreads connections across them.
+  if (options_.workers > 0 && setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+    std::cerr << "Error: Cannot share port " << options_.port << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(options_.port);
+  if (inet_pton(AF_INET, options_.host.c_str(), &address.sin_addr) != 1) {
+    std::cerr << "Error: Invalid host " << options_.host << std::endl;
+    return false;
+  }
+
+  if (bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listenFd_, SOMAXCONN) < 0) {
+    std::cerr << "Error: Cannot listen on " << options_.host << ":" << options_.port << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int Server::run() {
+  if (options_.workers > 0) {
+    // Workers fork with the route table and its libraries already loaded, and each runs its own event loop and pool.
+    Supervisor supervisor(
+        options_.workers,
+        [this] {
+          reload();
+          Epoch::collect();
+        },
+        [this] {
+          int status = serve();
+          // Each worker writes its own trace, once its threads have stopped recording.
+          pool_.reset();
+          reactor_.reset();
+          if (!options_.traceFile.empty()) {
+            Trace::write(options_.traceFile.string() + "." + std::to_string(getpid()));
+          }
+          return status;
+        });
+    return supervisor.run();
+  }
+  return serve();
+}
+
+int Server::serve() {
+  if (options_.ioUring && !ring_) {
+    try {
+      ring_ = std::make_unique<IoUring>(ringEntries, receiveBufferCount, receiveBufferSize);
+    } catch (const std::exception& error) {
+      std::cerr << "Warning: io_uring is unavailable (" << error.what() << "), falling back to epoll." << std::endl;
+    }
+  }
+  if (!ring_) {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  }
+  stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  signalFd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  signal(SIGPIPE, SIG_IGN);
+
+  if ((!ring_ && epollFd_ < 0) || stopFd_ < 0 || wakeFd_ < 0 || timerFd_ < 0 || signalFd_ < 0 || !listen()) {
+    return 1;
+  }
+
+  if (options_.hotReload && !options_.routerDirectory.empty() && !reloader_.joinable()) {
+    watcher_ = std::make_unique<Watcher>(std::vector<std::filesystem::path>{options_.routerDirectory});
+    reloader_ = std::thread([this] {
+      while (true) {
+        auto changed = watcher_->wait();
+        if (changed.empty() && !watcher_->overflowed()) {
+          return;
+        }
+        if (!watcher_->overflowed() && std::none_of(changed.begin(), changed.end(), [](const auto& path) { return path.filename() == "page.so"; })) {
+          continue;
+        }
+
+        reload();
+        while (Epoch::collect(), Epoch::pending() > 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      }
+    });
+  }
+
+  if (!reactor_) {
+    try {
+      reactor_ = std::make_unique<Reactor>();
+    } catch (const std::exception& error) {
+      std::cerr << "Warning: " << error.what() << ", async pages will block their worker." << std::endl;
+    }
+  }
+
+  if (options_.threads > 0 && !pool_) {
+    pool_ = std::make_unique<ThreadPool>(options_.threads, options_.pinThreads);
+  }
+
+  std::cout << "Listening on http://" << options_.host << ":" << options_.port << (ring_ ? " (io_uring)" : "") << std::endl;
+
+  return ring_ ? serveRing() : serveEpoll();
+}
+
+int Server::serveEpoll() {
+  for (int fd : {listenFd_, signalFd_, stopFd_, wakeFd_, timerFd_}) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+  }
+  if (reactor_) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = reactor_->fd();
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, reactor_->fd(), &event);
+  }
+
+  epoll_event events[256];
+  while (true) {
+    int count = epoll_wait(epollFd_, events, 256, -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "Error: epoll_wait failed: " << std::strerror(errno) << std::endl;
+      return 1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+      int fd = events[i].data.fd;
+
+      if (fd == listenFd_) {
+        accept();
+        continue;
+      }
+      if (fd == signalFd_ && drain()) {
+        continue;
+      }
+      if (fd == signalFd_ || fd == stopFd_) {
+        return 0;
+      }
+      if (fd == wakeFd_) {
+        collect();
+        continue;
+      }
+      if (fd == timerFd_) {
+        publish();
+        continue;
+      }
+      if (reactor_ && fd == reactor_->fd()) {
+        reactor_->dispatch();
+        continue;
+      }
+
+      auto connection = connections_.find(fd);
+      if (connection == connections_.end()) {
+        continue;
+      }
+
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        close(fd);
+        continue;
+      }
+      if (events[i].events & EPOLLIN) {
+        read(fd, connection->second);
+        if (connections_.find(fd) == connections_.end()) continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+        flush(fd, connection->second);
+      }
+    }
+
+    if (draining_ && settled()) {
+      return 0;
+    }
+  }
+}
+
+void Server::stop() {
+  if (stopFd_ >= 0) {
+    uint64_t value = 1;
+    (void)!write(stopFd_, &value, sizeof(value));
+  }
+}
+
+bool Server::drain() {
+  signalfd_siginfo info;
+  while (::read(signalFd_, &info, sizeof(info)) > 0) {
+  }
+  if (draining_) {
+    return false;
+  }
+
+  // Connections already queued on this socket are taken first; with workers, new ones go to the others from here on.
+  draining_ = true;
+  drainDeadline_ = std::chrono::steady_clock::now() + drainTimeout;
+  if (ring_) {
+    // Ends the multishot accept, which otherwise holds the socket open.
+    shutdown(listenFd_, SHUT_RD);
+  } else {
+    accept();
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, listenFd_, nullptr);
+  }
+  ::close(listenFd_);
+  listenFd_ = -1;
+
+  // Wakes the loop when the deadline passes, whether or not anything else happens.
+  itimerspec spec{};
+  spec.it_value.tv_sec = drainTimeout.count();
+  timerfd_settime(timerFd_, 0, &spec, nullptr);
+  timerArmed_ = true;
+  return true;
+}
+
+bool Server::settled() const {
+  if (std::chrono::steady_clock::now() >= drainDeadline_) {
+    return true;
+  }
+  // Live channels never finish on their own; clients reconnect to another worker.
+  return std::none_of(connections_.begin(), connections_.end(), [](const auto& entry) {
+    const Connection& connection = entry.second;
+    return connection.protocol == Protocol::Http && (!connection.pending.empty() || !connection.output.empty() || connection.writing);
+  });
+}
+
+int Server::serveRing() {
+  arm(Operation::Accept, listenFd_);
+  for (int fd : {signalFd_, stopFd_, wakeFd_, timerFd_}) {
+    arm(Operation::Poll, fd);
+  }
+  if (reactor_) {
+    arm(Operation::Poll, reactor_->fd());
+  }
+
+  // One io_uring_enter per pass both submits everything the previous pass queued and waits for more work.
+  while (true) {
+    if (ring_->submit(true) < 0) {
+      std::cerr << "Error: io_uring_enter failed: " << std::strerror(errno) << std::endl;
+      return 1;
+    }
+
+    while (const io_uring_cqe* entry = ring_->peek()) {
+      io_uring_cqe completion = *entry;
+      ring_->advance();
+      bool more = completion.flags & IORING_CQE_F_MORE;
+
+      switch (static_cast<Operation>(completion.user_data & 7)) {
+        case Operation::Accept:
+          if (completion.res >= 0) admit(completion.res);
+          if (!more && listenFd_ >= 0) arm(Operation::Accept, listenFd_);
+          break;
+        case Operation::Poll: {
+          int fd = static_cast<int>(completion.user_data >> 3);
+          if (!more) arm(Operation::Poll, fd);
+          if (fd == signalFd_ && drain()) break;
+          if (fd == signalFd_ || fd == stopFd_) return 0;
+          if (fd == wakeFd_) collect();
+          if (fd == timerFd_) publish();
+          if (reactor_ && fd == reactor_->fd()) reactor_->dispatch();
+          break;
+        }
+        case Operation::Receive:
+          received(completion);
+          break;
+        case Operation::Send:
+          sent(completion);
+          break;
+        case Operation::Writable: {
+          int fd = static_cast<int>((completion.user_data >> 3) & 0x1fffffff);
+          auto connection = connections_.find(fd);
+          if (connection != connections_.end() && static_cast<uint32_t>(connection->second.id) == completion.user_data >> 32) {
+            connection->second.writing = false;
+            flush(fd, connection->second);
+          }
+          break;
+        }
+      }
+    }
+
+    if (draining_ && settled()) {
+      return 0;
+    }
+  }
+}
+
+void Server::accept() {
+  while (true) {
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return;
+    }
+    admit(fd);
+  }
+}
+
+void Server::admit(int fd) {
+  int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+  if (!ring_) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      ::close(fd);
+      return;
+    }
+  }
+
+  Connection connection;
+  connection.id = ++lastConnectionId_;
+  connections_.emplace(fd, std::move(connection));
+
+  if (ring_) {
+    arm(Operation::Receive, fd, lastConnectionId_);
+  }
+}
+
+void Server::arm(Operation operation, int fd, uint64_t id) {
+  // Per-connection operations carry the connection ID too, since a descriptor number is reused once closed.
+  uint64_t data = (id << 32) | (static_cast<uint64_t>(fd) << 3) | static_cast<uint64_t>(operation);
+  io_uring_sqe* sqe = nullptr;
+
+  switch (operation) {
+    case Operation::Accept:
+      sqe = ring_->prepare(IORING_OP_ACCEPT, fd, data);
+      sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+      break;
+    case Operation::Poll:
+      sqe = ring_->prepare(IORING_OP_POLL_ADD, fd, data);
+      sqe->len = IORING_POLL_ADD_MULTI;
+      sqe->poll32_events = POLLIN;
+      break;
+    case Operation::Receive:
+      sqe = ring_->prepare(IORING_OP_RECV, fd, data);
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = IoUring::bufferGroup;
+      break;
+    case Operation::Writable:
+      sqe = ring_->prepare(IORING_OP_POLL_ADD, fd, data);
+      sqe->poll32_events = POLLOUT;
+      break;
+    case Operation::Send:
+      break;
+  }
+}
+
+void Server::received(const io_uring_cqe& completion) {
+  int fd = static_cast<int>((completion.user_data >> 3) & 0x1fffffff);
+  auto connection = connections_.find(fd);
+  bool current = connection != connections_.end() && static_cast<uint32_t>(connection->second.id) == completion.user_data >> 32;
+
+  if (completion.flags & IORING_CQE_F_BUFFER) {
+    auto buffer = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (current && completion.res > 0) {
+      connection->second.input.append(ring_->buffer(buffer), static_cast<size_t>(completion.res));
+    }
+    ring_->recycle(buffer);
+  }
+
+  if (!current) {
+    return;
+  }
+  if (connection->second.input.size() >= maxBufferedInput) {
+    // A multishot receive cannot be paused, so a connection that keeps sending past a full pipeline is cut off.
+    close(fd);
+    return;
+  }
+
+  if (completion.res > 0 || completion.res == -ENOBUFS) {
+    if (!(completion.flags & IORING_CQE_F_MORE)) {
+      arm(Operation::Receive, fd, connection->second.id);
+    }
+  } else {
+    connection->second.peerClosed = true;
+  }
+
+  advance(fd, connection->second);
+}
+
+void Server::sent(const io_uring_cqe& completion) {
+  auto* transfer = reinterpret_cast<Transfer*>(completion.user_data & ~uint64_t(7));
+  auto connection = connections_.find(transfer->fd);
+
+  if (connection == connections_.end() || connection->second.transfer.get() != transfer) {
+    auto orphan = std::find_if(orphans_.begin(), orphans_.end(), [transfer](const auto& orphan) { return orphan.get() == transfer; });
+    if (orphan != orphans_.end()) orphans_.erase(orphan);
+    return;
+  }
+
+  transfer->active = false;
+  if (completion.res < 0) {
+    close(transfer->fd);
+    return;
+  }
+
+  Trace::count(Trace::Counter::BytesSent, static_cast<size_t>(completion.res));
+  connection->second.output.consume(static_cast<size_t>(completion.res));
+  flush(transfer->fd, connection->second);
+}
+
+bool Server::submit(int fd, Connection& connection) {
+  if (connection.transfer && connection.transfer->active) {
+    return false;
+  }
+  if (connection.output.empty()) {
+    return true;
+  }
+
+  if (!connection.transfer) {
+    connection.transfer = std::make_unique<Transfer>();
+    connection.transfer->fd = fd;
+    connection.transfer->id = connection.id;
+  }
+
+  Transfer& transfer = *connection.transfer;
+  int count = connection.output.gather(transfer.vectors, ResponseWriter::maxVectors);
+  if (count == 0) {
+    // Cached files go out with sendfile on the non-blocking socket; the ring only waits for room when it is full.
+    switch (connection.output.flush(fd)) {
+      case ResponseWriter::Result::Complete:
+        return true;
+      case ResponseWriter::Result::Blocked:
+        if (!connection.writing) {
+          connection.writing = true;
+          arm(Operation::Writable, fd, connection.id);
+        }
+        return false;
+      case ResponseWriter::Result::Failed:
+        close(fd);
+        return false;
+    }
+  }
+
+  transfer.message.msg_iov = transfer.vectors;
+  transfer.message.msg_iovlen = static_cast<size_t>(count);
+  io_uring_sqe* sqe = ring_->prepare(IORING_OP_SENDMSG, fd, reinterpret_cast<uint64_t>(&transfer) | static_cast<uint64_t>(Operation::Send));
+  sqe->addr = reinterpret_cast<uint64_t>(&transfer.message);
+  sqe->msg_flags = MSG_NOSIGNAL;
+  transfer.active = true;
+  return false;
+}
+
+void Server::read(int fd, Connection& connection) {
+  char buffer[16 * 1024];
+
+  while (true) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received > 0) {
+      connection.input.append(buffer, static_cast<size_t>(received));
+      if (connection.input.size() >= maxBufferedInput) {
+        close(fd);
+        return;
+      }
+      continue;
+    }
+    if (received == 0) {
+      connection.peerClosed = true;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      connection.peerClosed = true;
+    }
+    break;
+  }
+
+  if (connection.peerClosed) {
+    // Stop polling for input, or level-triggered epoll reports the hangup until pending renders finish.
+    update(fd, connection);
+  }
+
+  advance(fd, connection);
+}
+
+void Server::process(int fd, Connection& connection) {
+  if (connection.protocol == Protocol::WebSocket) {
+    receive(connection);
+    return;
+  }
+  if (connection.protocol == Protocol::EventStream) {
+    connection.input.clear();
+    return;
+  }
+
+  size_t offset = 0;
+
+  while (!connection.lastRequest && connection.pending.size() < maxPipelined && offset < connection.input.size()) {
+    HttpRequest request;
+    size_t consumed = 0;
+    auto result = HttpRequest::parse(std::string_view(connection.input).substr(offset), request, consumed);
+
+    if (result == HttpRequest::ParseResult::Incomplete) {
+      break;
+    }
+
+    auto exchange = std::make_shared<Exchange>();
+    connection.pending.push_back(exchange);
+
+    if (result == HttpRequest::ParseResult::Invalid) {
+      HttpResponse response;
+      response.status = 400;
+      response.contentType = "text/plain; charset=utf-8";
+      response.body = "Bad Request";
+      response.keepAlive = false;
+      response.write(exchange->output);
+      exchange->keepAlive = false;
+      exchange->done = true;
+      connection.lastRequest = true;
+      offset = connection.input.size();
+      break;
+    }
+
+    if (request.path == livePath || request.path == eventsPath) {
+      upgrade(fd, request, connection, *exchange);
+      offset += consumed;
+      break;
+    }
+
+    exchange->request.assign(connection.input, offset, consumed);
+    connection.lastRequest = !request.keepAlive;
+    offset += consumed;
+
+    if (pool_) {
+      pool_->submit([this, exchange, fd, id = connection.id] {
+        if (respond(exchange, fd, id)) complete(fd, id);
+      });
+    } else {
+      respond(exchange, fd, connection.id);
+    }
+  }
+
+  connection.input.erase(0, offset);
+
+  if (connection.protocol == Protocol::WebSocket && !connection.input.empty()) {
+    receive(connection);
+  }
+}
+
+bool Server::respond(const std::shared_ptr<Exchange>& exchange, int fd, uint64_t id) {
+  size_t consumed = 0;
+  HttpRequest::parse(exchange->request, exchange->parsed, consumed);
+
+  // A suspended page finishes on another thread, which then replies and wakes the event loop itself.
+  auto finish = [this, exchange, fd, id] {
+    reply(*exchange);
+    complete(fd, id);
+  };
+  auto sink = [this, exchange, fd, id](std::string output, bool last) {
+    {
+      std::lock_guard<std::mutex> lock(exchange->mutex);
+      exchange->output.append(std::move(output));
+      exchange->streaming.store(true, std::memory_order_release);
+      if (last) exchange->done.store(true, std::memory_order_release);
+    }
+    complete(fd, id);
+  };
+  bool finished = handle(exchange->parsed, exchange->response, std::move(finish), std::move(sink));
+  if (finished) {
+    reply(*exchange);
+  }
+  return finished;
+}
+
+void Server::reply(Exchange& exchange) {
+  const HttpRequest& request = exchange.parsed;
+  HttpResponse& response = exchange.response;
+  if (response.streaming) {
+    return;
+  }
+  response.keepAlive = response.keepAlive && request.keepAlive;
+  if (response.keepAlive && request.minorVersion == 0) {
+    response.headers.emplace_back("Connection", "keep-alive");
+  }
+
+  response.write(exchange.output, request.method != "HEAD");
+
+  exchange.keepAlive = response.keepAlive;
+  exchange.done.store(true, std::memory_order_release);
+}
+
+void Server::complete(int fd, uint64_t id) {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(completedMutex_);
+    wake = completed_.empty() && posted_.empty();
+    completed_.emplace_back(fd, id);
+  }
+
+  if (wake) {
+    uint64_t value = 1;
+    (void)!write(wakeFd_, &value, sizeof(value));
+  }
+}
+
+void Server::post(std::function<void()> task) {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(completedMutex_);
+    wake = completed_.empty() && posted_.empty();
+    posted_.push_back(std::move(task));
+  }
+
+  if (wake) {
+    uint64_t value = 1;
+    (void)!write(wakeFd_, &value, sizeof(value));
+  }
+}
+
+void Server::collect() {
+  uint64_t value = 0;
+  (void)!::read(wakeFd_, &value, sizeof(value));
+
+  std::vector<std::pair<int, uint64_t>> completed;
+  std::vector<std::function<void()>> posted;
+  {
+    std::lock_guard<std::mutex> lock(completedMutex_);
+    completed.swap(completed_);
+    posted.swap(posted_);
+  }
+
+  for (auto& task : posted) {
+    task();
+  }
+
+  for (const auto& [fd, id] : completed) {
+    auto connection = connections_.find(fd);
+    if (connection != connections_.end() && connection->second.id == id) {
+      advance(fd, connection->second);
+    }
+  }
+}
+
+void Server::queue(Connection& connection, std::string output, bool keepAlive) {
+  auto exchange = std::make_shared<Exchange>();
+  exchange->output.append(std::move(output));
+  exchange->keepAlive = keepAlive;
+  exchange->done = true;
+  connection.pending.push_back(std::move(exchange));
+}
+
+void Server::advance(int fd, Connection& connection) {
+  // Responses leave in request order, so a finished render waits behind any slower one before it.
+  while (true) {
+    process(fd, connection);
+
+    bool progressed = false;
+    while (!connection.pending.empty()) {
+      Exchange& exchange = *connection.pending.front();
+      if (exchange.streaming.load(std::memory_order_acquire)) {
+        // Whatever a streamed response has so far goes out now; it keeps its place until its last chunk.
+        std::lock_guard<std::mutex> lock(exchange.mutex);
+        connection.output.append(std::move(exchange.output));
+        if (!exchange.done.load(std::memory_order_relaxed)) break;
+      } else if (exchange.done.load(std::memory_order_acquire)) {
+        connection.output.append(std::move(exchange.output));
+      } else {
+        break;
+      }
+      progressed = true;
+
+      if (!exchange.keepAlive) {
+        connection.closeAfterWrite = true;
+        connection.pending.clear();
+        break;
+      }
+      connection.pending.pop_front();
+    }
+
+    if (!progressed || connection.closeAfterWrite || connection.input.empty()) {
+      break;
+    }
+  }
+
+  bool full = connection.protocol == Protocol::Http && connection.pending.size() >= maxPipelined;
+  if (full != connection.paused) {
+    connection.paused = full;
+    update(fd, connection);
+  }
+
+  flush(fd, connection);
+}
+
+void Server::flush(int fd, Connection& connection) {
+  if (ring_) {
+    if (!submit(fd, connection)) {
+      return;
+    }
+  } else {
+    ResponseWriter::Result result;
+    {
+      Trace::Span span("write");
+      size_t size = connection.output.size();
+      result = connection.output.flush(fd);
+      Trace::count(Trace::Counter::BytesSent, size - connection.output.size());
+    }
+    switch (result) {
+      case ResponseWriter::Result::Complete:
+        break;
+      case ResponseWriter::Result::Blocked:
+        if (!connection.writing) {
+          connection.writing = true;
+          update(fd, connection);
+        }
+        return;
+      case ResponseWriter::Result::Failed:
+        close(fd);
+        return;
+    }
+  }
+
+  if (connection.protocol != Protocol::Http) {
+    // Idle push connections should cost little more than the socket.
+    connection.input.shrink_to_fit();
+  }
+
+  if (connection.closeAfterWrite || (connection.peerClosed && connection.pending.empty())) {
+    close(fd);
+    return;
+  }
+
+  if (connection.writing) {
+    connection.writing = false;
+    update(fd, connection);
+  }
+}
+
+void Server::update(int fd, const Connection& connection) {
+  if (ring_) {
+    return;
+  }
+
+  epoll_event event{};
+  event.events = (connection.peerClosed || connection.paused ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) | (connection.writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+  event.data.fd = fd;
+  epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event);
+}
+
+void Server::close(int fd) {
+  auto connection = connections_.find(fd);
+  if (connection != connections_.end() && connection->second.live) {
+    auto subscribers = subscribers_.find(connection->second.live.get());
+    if (subscribers != subscribers_.end()) {
+      auto& list = subscribers->second;
+      list.erase(std::remove(list.begin(), list.end(), std::make_pair(fd, connection->second.id)), list.end());
+      if (list.empty()) subscribers_.erase(subscribers);
+    }
+  }
+
+  if (ring_) {
+    if (connection != connections_.end() && connection->second.transfer && connection->second.transfer->active) {
+      // The kernel may still be reading this output, so it lives until the send completes.
+      connection->second.transfer->orphaned.append(std::move(connection->second.output));
+      orphans_.push_back(std::move(connection->second.transfer));
+    }
+    // Queued entries name the descriptor by number, so they must reach the kernel before the number is reused.
+    if (ring_->pending()) {
+      ring_->submit();
+    }
+    // Ends the multishot receive, which otherwise holds the socket open.
+    shutdown(fd, SHUT_RDWR);
+  } else {
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  }
+
+  ::close(fd);
+  connections_.erase(fd);
+}
+
+void Server::handle(const HttpRequest& request, HttpResponse& response) {
+  std::promise<void> finished;
+  if (!handle(request, response, [&finished] { finished.set_value(); })) {
+    finished.get_future().wait();
+  }
+}
+
+bool Server::handle(const HttpRequest& request, HttpResponse& response, std::function<void()> finished, Sink sink) {
+  if (request.path.substr(0, callPrefix.size()) == callPrefix) {
+    invoke(request, response);
+    return true;
+  }
+
+  if (options_.metrics && request.path == metricsPath) {
+    response.contentType = "text/plain; version=0.0.4; charset=utf-8";
+    response.body = Trace::prometheus();
+    return true;
+  }
+
+  if (request.method != "GET" && request.method != "HEAD") {
+    response.status = 405;
+    response.contentType = "text/plain; charset=utf-8";
+    response.headers.emplace_back("Allow", "GET, HEAD");
+    response.body = "Method Not Allowed";
+    return true;
+  }
+
+  Trace::count(Trace::Counter::Requests);
+  Epoch::Guard guard;
+  const Router* router = router_.load();
+
+  Router::Match match;
+  if (!router->match(request.path, match)) {
+    response.status = 404;
+    response.contentType = "text/plain; charset=utf-8";
+    response.body = "404 Page Not Found";
+    return true;
+  }
+
+  Compression::Encoding encoding = Compression::Encoding::Identity;
+  if (options_.compressionLevel > 0) {
+    encoding = Compression::negotiate(request.header("Accept-Encoding"));
+    response.headers.emplace_back("Vary", "Accept-Encoding");
+  }
+
+  try {
+    Router::Scope scope(match);
+    if (options_.renderCache) {
+      if (auto body = cache_.find(request.path, encoding)) {
+        Trace::count(Trace::Counter::CacheHits);
+        response.sharedBody = std::move(body.data);
+        response.bodyFile = std::move(body.file);
+        encode(response, encoding);
+        return true;
+      }
+    }
+
+    if (match.asyncPage) {
+      defer(match, match.asyncPage(), [this, &request, &response, encoding, finished = std::move(finished), sink = std::move(sink)](AsyncRender& deferred) {
+        bool done = true;
+        try {
+          Router::Scope scope(deferred.match);
+          done = present(request, response, deferred.match, deferred.task->result(), deferred.recorder, encoding, finished, sink);
+        } catch (const std::exception& error) {
+          failed(request, response, error);
+        }
+        if (done) finished();
+      });
+      return false;
+    }
+
+    Trace::Sample sample(match.route);
+    uint64_t jsonValues = JSON::valuesBuilt();
+    RenderCache::Recorder recorder;
+    Page page;
+    {
+      Trace::Span span("page", match.route);
+      RenderCache::Recorder::Scope recording(&recorder);
+      page = match.page();
+    }
+    bool done = present(request, response, match, std::move(page), recorder, encoding, finished, sink);
+    sample.jsonValues = JSON::valuesBuilt() - jsonValues;
+    return done;
+  } catch (const std::exception& error) {
+    failed(request, response, error);
+  }
+  return true;
+}
+
+bool Server::present(const HttpRequest& request, HttpResponse& response, const Router::Match& match, Page page, RenderCache::Recorder& recorder, Compression::Encoding encoding,
+                     const std::function<void()>& finished, const Sink& sink) {
+  if (recorder.deferred.empty()) {
+    render(request, response, match, std::move(page), recorder, encoding);
+    return true;
+  }
+
+  // A live page is patched against its tree, which must then hold the content the client shows, so it waits like HTTP/1.0 does.
+  std::vector<const JSON::Callable*> callables;
+  Html::collect(page, callables);
+  if (sink && callables.empty() && request.method == "GET" && request.minorVersion > 0 && request.keepAlive) {
+    stream(response, match, page, std::move(recorder.deferred), encoding, sink);
+    return true;
+  }
+
+  resolve(match, std::move(page), std::move(recorder.deferred), [this, &request, &response, encoding, finished](const Router::Match& match, Page page) {
+    try {
+      RenderCache::Recorder uncached;
+      uncached.dynamic = true;
+      render(request, response, match, std::move(page), uncached, encoding);
+    } catch (const std::exception& error) {
+      failed(request, response, error);
+    }
+    finished();
+  });
+  return false;
+}
+
+void Server::render(const HttpRequest& request, HttpResponse& response, const Router::Match& match, Page page, const RenderCache::Recorder& recorder, Compression::Encoding encoding) {
+  std::vector<const JSON::Callable*> callables;
+  {
+    Trace::Span span("stringify");
+    Html::render(page, response.body, &callables);
+  }
+  if (auto* sample = Trace::Sample::current()) {
+    sample->bytes = response.body.size();
+  }
+  if (!callables.empty()) {
+    attach(request, response, match, std::move(page), std::move(callables));
+  } else if (options_.renderCache && recorder.caches()) {
+    if (auto body = cache_.store(request.path, recorder, std::move(response.body), encoding)) {
+      response.body.clear();
+      response.sharedBody = std::move(body.data);
+      response.bodyFile = std::move(body.file);
+      encode(response, encoding);
+      return;
+    }
+  }
+
+  compress(request, response, encoding);
+}
+
+void Server::defer(const Router::Match& match, AsyncPage task, std::function<void(AsyncRender&)> finish) {
+  auto deferred = std::make_shared<AsyncRender>();
+  deferred->match = match;
+  deferred->route = std::string(match.route);
+  deferred->match.route = deferred->route;
+  for (size_t i = 0; i < match.paramCount; ++i) {
+    deferred->params[i] = {std::string(match.params[i].first), std::string(match.params[i].second)};
+    deferred->match.params[i] = {deferred->params[i].first, deferred->params[i].second};
+  }
+  deferred->library = match.library ? *match.library : nullptr;
+  deferred->match.library = &deferred->library;
+
+  // The page runs here until it first suspends; the reactor resumes it on the event loop, and rendering moves to a worker.
+  Router::Scope scope(deferred->match);
+  RenderCache::Recorder::Scope recording(&deferred->recorder);
+  deferred->task.emplace(std::move(task));
+  deferred->task->start([this, deferred, finish = std::move(finish)] {
+    if (pool_) {
+      pool_->submit([deferred, finish] { finish(*deferred); });
+    } else {
+      finish(*deferred);
+    }
+  });
+}
+
+void Server::resolve(const Router::Match& match, Page page, std::vector<AsyncPage> deferred, std::function<void(const Router::Match&, Page)> finish) {
+  struct Progress {
+    std::mutex mutex;
+    Page page;
+    std::vector<std::optional<Page>> contents;
+    size_t remaining = 0;
+    std::function<void(const Router::Match&, Page)> finish;
+  };
+
+  auto progress = std::make_shared<Progress>();
+  progress->page = std::move(page);
+  progress->contents.resize(deferred.size());
+  progress->remaining = deferred.size();
+  progress->finish = std::move(finish);
+
+  for (size_t i = 0; i < deferred.size(); ++i) {
+    defer(match, std::move(deferred[i]), [progress, i](AsyncRender& render) {
+      std::optional<Page> content;
+      try {
+        content = render.task->result();
+      } catch (const std::exception& error) {
+        std::cerr << "Error: Deferred content failed: " << error.what() << std::endl;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(progress->mutex);
+        progress->contents[i] = std::move(content);
+        if (--progress->remaining > 0) return;
+      }
+      splice(progress->page, progress->contents);
+      progress->finish(render.match, std::move(progress->page));
+    });
+  }
+}
+
+void Server::stream(HttpResponse& response, const Router::Match& match, const Page& page, std::vector<AsyncPage> deferred, Compression::Encoding encoding, Sink sink) {
+  struct Progress {
+    std::mutex mutex;
+    std::optional<Compression::Stream> compression;
+    std::string tail;
+    size_t remaining = 0;
+    Sink sink;
+
+    // Every piece is flushed through the compressor, so the browser can show it before the rest arrives.
+    void write(std::string_view html, bool last, std::string& output) {
+      if (!compression) {
+        HttpResponse::chunk(html, output);
+      } else {
+        std::string piece;
+        compression->write(html, piece);
+        last ? compression->finish(piece) : compression->flush(piece);
+        HttpResponse::chunk(piece, output);
+      }
+      if (last) HttpResponse::lastChunk(output);
+    }
+  };
+
+  auto progress = std::make_shared<Progress>();
+  progress->remaining = deferred.size();
+  progress->sink = std::move(sink);
+
+  // The shell goes out at once without its closing tags, which follow the last deferred subtree.
+  std::string html;
+  {
+    Trace::Span span("stringify");
+    Html::render(page, html);
+  }
+  size_t bodyEnd = html.rfind("</body>");
+  if (bodyEnd == std::string::npos) bodyEnd = html.size();
+  progress->tail = html.substr(bodyEnd);
+  html.resize(bodyEnd);
+  html += "<script>function cppxResolve(i){const t=document.getElementById(\"cppx-deferred-\"+i+\"-content\");"
+          "document.getElementById(\"cppx-deferred-\"+i).replaceWith(t.content);t.remove();document.currentScript.remove()}</script>";
+
+  response.chunked = true;
+  response.streaming = true;
+  if (encoding != Compression::Encoding::Identity) {
+    progress->compression.emplace(encoding, options_.compressionLevel);
+    encode(response, encoding);
+  }
+
+  std::string output;
+  response.serializeHead(output);
+  progress->write(html, false, output);
+  progress->sink(std::move(output), false);
+
+  for (size_t i = 0; i < deferred.size(); ++i) {
+    defer(match, std::move(deferred[i]), [progress, i](AsyncRender& render) {
+      std::string html = "<template id=\"cppx-deferred-" + std::to_string(i) + "-content\">";
+      try {
+        Html::render(render.task->result(), html);
+        html += "</template><script>cppxResolve(" + std::to_string(i) + ")</script>";
+      } catch (const std::exception& error) {
+        // The fallback stays in place.
+        std::cerr << "Error: Deferred content failed: " << error.what() << std::endl;
+        html.clear();
+      }
+
+      // Subtrees go out in the order they resolve; the lock keeps their chunks, and the compressor, in one sequence.
+      std::lock_guard<std::mutex> lock(progress->mutex);
+      std::string output;
+      bool last = --progress->remaining == 0;
+      if (!html.empty()) progress->write(html, false, output);
+      if (last) progress->write(progress->tail, true, output);
+      progress->sink(std::move(output), last);
+    });
+  }
+}
+
+void Server::encode(HttpResponse& response, Compression::Encoding encoding) {
+  if (encoding != Compression::Encoding::Identity) {
+    response.headers.emplace_back("Content-Encoding", std::string(Compression::name(encoding)));
+  }
+}
+
+void Server::compress(const HttpRequest& request, HttpResponse& response, Compression::Encoding encoding) {
+  if (encoding == Compression::Encoding::Identity || response.body.size() < minCompressedSize) {
+    return;
+  }
+
+  Trace::Span span("compress");
+  Compression::Stream stream(encoding, options_.compressionLevel);
+  std::string output;
+
+  if (request.minorVersion == 0) {
+    stream.write(response.body, output);
+    stream.finish(output);
+  } else {
+    // Dynamic output is compressed as it goes and framed in chunks, so its compressed size is never needed up front.
+    std::string piece;
+    for (size_t offset = 0; offset < response.body.size(); offset += compressedChunkSize) {
+      piece.clear();
+      stream.write(std::string_view(response.body).substr(offset, compressedChunkSize), piece);
+      HttpResponse::chunk(piece, output);
+    }
+    piece.clear();
+    stream.finish(piece);
+    HttpResponse::chunk(piece, output);
+    HttpResponse::lastChunk(output);
+    response.chunked = true;
+  }
+
+  response.body = std::move(output);
+  encode(response, encoding);
+}
+
+void Server::attach(const HttpRequest& request, HttpResponse& response, const Router::Match& match, Page page, std::vector<const JSON::Callable*> callables) {
+  // A client without a session gets none until it subscribes, so pages fetched without the script running hold no memory.
+  auto session = sessions_.find(Sessions::cookie(request.header("Cookie")));
+
+  uint32_t generation = 1;
+  if (session) {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    // The previous page is released before its library, which may hold the code of its callables.
+    session->page = std::move(page);
+    session->callables = std::move(callables);
+    session->library = match.library ? *match.library : nullptr;
+    session->path = std::string(request.path);
+    session->lastUsed = std::chrono::steady_clock::now();
+    generation = ++session->generation;
+  }
+
+  // Calls go out with the current generation; patches from the live channel update the DOM and the generation.
+  std::string script = "<script>(()=>{let g=" + std::to_string(generation) + ";window.cppx=i=>fetch(\"" + std::string(callPrefix) +
+                       "\"+g+\"/\"+i,{method:\"POST\"}).then(r=>{if(r.status==410)location.reload()});"
+                       "const b=n=>{if(typeof n==\"string\")return document.createTextNode(n);const e=document.createElement(n.t);for(const k in n.a)e.setAttribute(k,n.a[k]);for(const c of n.c)e.appendChild(b(c));return e};"
+                       "const p=d=>{const m=JSON.parse(d);if(m.reload)return location.reload();g=m.g;for(const o of m.ops){let n=document.documentElement;for(const i of o.path)n=n.childNodes[i];"
+                       "if(o.op==\"text\")n.nodeValue=o.value;else if(o.op==\"attr\")o.value===undefined?n.removeAttribute(o.name):n.setAttribute(o.name,o.value);else n.replaceChildren(...o.value.map(b))}};"
+                       "if(window.WebSocket)new WebSocket((location.protocol==\"https:\"?\"wss://\":\"ws://\")+location.host+\"" + std::string(livePath) + "?\"+location.pathname).onmessage=e=>p(e.data);"
+                       "else new EventSource(\"" + std::string(eventsPath) + "?\"+location.pathname).onmessage=e=>p(e.data)})()</script>";
+  size_t bodyEnd = response.body.rfind("</body>");
+  response.body.insert(bodyEnd == std::string::npos ? response.body.size() : bodyEnd, script);
+}
+
+void Server::invoke(const HttpRequest& request, HttpResponse& response) {
+  response.contentType = "text/plain; charset=utf-8";
+
+  if (request.method != "POST") {
+    response.status = 405;
+    response.headers.emplace_back("Allow", "POST");
+    response.body = "Method Not Allowed";
+    return;
+  }
+
+  std::string_view target = request.path.substr(callPrefix.size());
+  size_t slash = target.find('/');
+  uint32_t generation = 0;
+  size_t index = 0;
+  if (slash == std::string_view::npos || std::from_chars(target.data(), target.data() + slash, generation).ec != std::errc() ||
+      std::from_chars(target.data() + slash + 1, target.data() + target.size(), index).ec != std::errc()) {
+    response.status = 404;
+    response.body = "404 Page Not Found";
+    return;
+  }
+
+  // A stale generation means the page was re-rendered since; the client reloads instead of firing the wrong handler.
+  auto session = sessions_.find(Sessions::cookie(request.header("Cookie")));
+  if (!session) {
+    response.status = 410;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(session->mutex);
+  if (generation != session->generation || index >= session->callables.size()) {
+    response.status = 410;
+    return;
+  }
+  session->lastUsed = std::chrono::steady_clock::now();
+
+  try {
+    (*session->callables[index])();
+    response.status = 204;
+    post([this, session] {
+      dirty_.insert(session);
+      if (!timerArmed_) {
+        // Events within one frame window share a single re-render and patch.
+        itimerspec timer{};
+        timer.it_value.tv_sec = options_.frameWindow.count() / 1000;
+        timer.it_value.tv_nsec = (options_.frameWindow.count() % 1000) * 1000000 + 1;
+        timerfd_settime(timerFd_, 0, &timer, nullptr);
+        timerArmed_ = true;
+      }
+    });
+  } catch (const std::exception& error) {
+    std::cerr << "Error: Callable " << index << " failed: " << error.what() << std::endl;
+    response.status = 500;
+    response.body = "500 Internal Server Error";
+  }
+}
+
+void Server::upgrade(int fd, const HttpRequest& request, Connection& connection, Exchange& exchange) {
+  exchange.done = true;
+
+  auto session = sessions_.find(Sessions::cookie(request.header("Cookie")));
+  bool webSocket = request.path == livePath;
+  std::string key(request.header("Sec-WebSocket-Key"));
+  // The channel names the page the client shows, so a session can start here for a page rendered without one.
+  bool valid = request.method == "GET" && (!webSocket || !key.empty());
+  std::string cookie;
+
+  if (valid && !session && !request.query.empty() && request.query.front() == '/') {
+    std::string id;
+    session = sessions_.create(id);
+    {
+      std::lock_guard<std::mutex> lock(session->mutex);
+      session->path = std::string(request.query);
+    }
+    cookie = "Set-Cookie: " + std::string(Sessions::cookieName) + "=" + id + "; Path=/; HttpOnly; SameSite=Strict\r\n";
+    if (pool_) {
+      pool_->submit([this, session] { refresh(session); });
+    } else {
+      refresh(session);
+    }
+  }
+
+  if (!valid || !session) {
+    HttpResponse response;
+    response.status = session ? 400 : 410;
+    response.contentType = "text/plain; charset=utf-8";
+    response.keepAlive = false;
+    response.write(exchange.output);
+    exchange.keepAlive = false;
+    connection.lastRequest = true;
+    return;
+  }
+
+  if (webSocket) {
+    exchange.output.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + WebSocket::acceptKey(key) + "\r\n" + cookie + "\r\n");
+    connection.protocol = Protocol::WebSocket;
+  } else {
+    exchange.output.append("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n" + cookie + "\r\n");
+    connection.protocol = Protocol::EventStream;
+  }
+
+  connection.live = session;
+  subscribers_[session.get()].emplace_back(fd, connection.id);
+}
+
+void Server::receive(Connection& connection) {
+  size_t offset = 0;
+
+  while (!connection.lastRequest && offset < connection.input.size()) {
+    WebSocket::Frame frame;
+    size_t consumed = 0;
+    auto result = WebSocket::parse(std::string_view(connection.input).substr(offset), frame, consumed);
+
+    if (result == WebSocket::ParseResult::Incomplete) {
+      break;
+    }
+
+    std::string output;
+    if (result == WebSocket::ParseResult::Invalid) {
+      WebSocket::frame(WebSocket::Opcode::Close, std::string_view("\x03\xea", 2), output);
+      queue(connection, std::move(output), false);
+      connection.lastRequest = true;
+      offset = connection.input.size();
+      break;
+    }
+
+    offset += consumed;
+
+    // The channel only pushes; client messages other than control frames are ignored.
+    if (frame.opcode == WebSocket::Opcode::Close) {
+      WebSocket::frame(WebSocket::Opcode::Close, std::string_view(frame.payload).substr(0, 2), output);
+      queue(connection, std::move(output), false);
+      connection.lastRequest = true;
+    } else if (frame.opcode == WebSocket::Opcode::Ping) {
+      WebSocket::frame(WebSocket::Opcode::Pong, frame.payload, output);
+      queue(connection, std::move(output));
+    }
+  }
+
+  connection.input.erase(0, offset);
+}
+
+void Server::publish() {
+  uint64_t expirations = 0;
+  (void)!::read(timerFd_, &expirations, sizeof(expirations));
+  timerArmed_ = false;
+
+  for (const auto& session : dirty_) {
+    if (subscribers_.find(session.get()) == subscribers_.end()) {
+      continue;
+    }
+
+    if (pool_) {
+      pool_->submit([this, session] { refresh(session); });
+    } else {
+      refresh(session);
+    }
+  }
+
+  dirty_.clear();
+}
+
+void Server::refresh(const std::shared_ptr<Sessions::Session>& session) {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    path = session->path;
+  }
+
+  Epoch::Guard guard;
+  const Router* router = router_.load();
+
+  Router::Match match;
+  if (!router->match(path, match)) {
+    post([this, session] { deliver(session, "{\"reload\":true}"); });
+    return;
+  }
+
+  auto reload = [this, session, path](const std::exception& error) {
+    std::cerr << "Error: Rendering " << path << " failed: " << error.what() << std::endl;
+    post([this, session] { deliver(session, "{\"reload\":true}"); });
+  };
+  // The client already shows deferred content, so the new tree has it resolved before it is compared.
+  auto settle = [this, session, path](const Router::Match& match, Page page, RenderCache::Recorder& recorder) {
+    if (recorder.deferred.empty()) {
+      repaint(session, path, match, std::move(page));
+      return;
+    }
+    resolve(match, std::move(page), std::move(recorder.deferred), [this, session, path](const Router::Match& match, Page page) { repaint(session, path, match, std::move(page)); });
+  };
+
+  try {
+    if (match.asyncPage) {
+      defer(match, match.asyncPage(), [settle, reload](AsyncRender& deferred) {
+        try {
+          settle(deferred.match, deferred.task->result(), deferred.recorder);
+        } catch (const std::exception& error) {
+          reload(error);
+        }
+      });
+      return;
+    }
+
+    RenderCache::Recorder recorder;
+    Page page;
+    {
+      Router::Scope scope(match);
+      RenderCache::Recorder::Scope recording(&recorder);
+      page = match.page();
+    }
+    settle(match, std::move(page), recorder);
+  } catch (const std::exception& error) {
+    reload(error);
+  }
+}
+
+void Server::repaint(const std::shared_ptr<Sessions::Session>& session, const std::string& path, const Router::Match& match, Page page) {
+  std::vector<const JSON::Callable*> callables;
+  Html::collect(page, callables);
+
+  std::string message;
+  {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    // A render that settles after the session has loaded another page would replace that page with this one.
+    if (session->path != path) {
+      return;
+    }
+    if (session->generation == 0) {
+      // A session started by its channel takes its first render as the one the client already shows.
+      session->generation = 1;
+      session->page = std::move(page);
+      session->callables = std::move(callables);
+      session->library = match.library ? *match.library : nullptr;
+      return;
+    }
+    message = Patch::diff(session->page, session->callables, page, callables, session->generation + 1);
+    if (!message.empty()) {
+      session->generation++;
+    }
+    session->page = std::move(page);
+    session->callables = std::move(callables);
+    session->library = match.library ? *match.library : nullptr;
+  }
+
+  if (!message.empty()) {
+    post([this, session, message = std::move(message)] { deliver(session, message); });
+  }
+}
+
+void Server::deliver(const std::shared_ptr<Sessions::Session>& session, const std::string& message) {
+  auto subscribers = subscribers_.find(session.get());
+  if (subscribers == subscribers_.end()) {
+    return;
+  }
+
+  // Copy first: advance() may close a connection and edit the subscriber list.
+  auto list = subscribers->second;
+  for (const auto& [fd, id] : list) {
+    auto connection = connections_.find(fd);
+    if (connection == connections_.end() || connection->second.id != id) {
+      continue;
+    }
+
+    if (connection->second.output.size() > maxLiveBacklog) {
+      close(fd);
+      continue;
+    }
+
+    std::string output;
+    if (connection->second.protocol == Protocol::WebSocket) {
+      WebSocket::frame(WebSocket::Opcode::Text, message, output);
+    } else {
+      output = "data: " + message + "\n\n";
+    }
+    queue(connection->second, std::move(output));
+    advance(fd, connection->second);
+  }
+}
@@ -0,0 +1,151 @@
+#include "cppx/session.hpp"
+
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+// Session IDs are bearer credentials, so they come from the kernel's CSPRNG rather than a seeded generator.
+void fillRandom(unsigned char* buffer, size_t size) {
+  size_t filled = 0;
+#if defined(__linux__)
+  while (filled < size) {
+    ssize_t read = getrandom(buffer + filled, size - filled, 0);
+    if (read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read < 0) {
+      break;
+    }
+    filled += static_cast<size_t>(read);
+  }
+#endif
+  if (filled == size) {
+    return;
+  }
+
+  std::ifstream urandom("/dev/urandom", std::ios::binary);
+  if (!urandom.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size))) {
+    throw std::runtime_error("Cannot read random bytes for a session ID.");
+  }
+}
+
+}  // namespace
+
+Sessions::Sessions(std::chrono::seconds timeToLive, size_t capacity) : timeToLive_(timeToLive), shardCapacity_(std::max<size_t>(1, capacity / shardCount)) {}
+
+Sessions::Shard& Sessions::shard(std::string_view id) { return shards_[std::hash<std::string_view>()(id) % shardCount]; }
+
+std::shared_ptr<Sessions::Session> Sessions::find(std::string_view id) {
+  if (id.empty()) {
+    return nullptr;
+  }
+
+  Shard& shard = this->shard(id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto session = shard.sessions.find(std::string(id));
+  return session == shard.sessions.end() ? nullptr : session->second;
+}
+
+std::shared_ptr<Sessions::Session> Sessions::create(std::string& id) {
+  static const char digits[] = "0123456789abcdef";
+
+  unsigned char bytes[16];
+  fillRandom(bytes, sizeof(bytes));
+  id.clear();
+  for (unsigned char byte : bytes) {
+    id += digits[byte >> 4];
+    id += digits[byte & 15];
+  }
+
+  auto session = std::make_shared<Session>();
+  auto now = std::chrono::steady_clock::now();
+  session->lastUsed = now;
+
+  // Expired sessions are released after the shard lock is dropped; their pages may be large.
+  std::vector<std::shared_ptr<Session>> expired;
+  {
+    Shard& shard = this->shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (now - shard.lastSweep > timeToLive_ / 8 || shard.sessions.size() >= shardCapacity_) {
+      sweep(shard, now, expired);
+    }
+    while (shard.sessions.size() >= shardCapacity_) {
+      evict(shard, expired);
+    }
+    shard.sessions[id] = session;
+  }
+
+  return session;
+}
+
+size_t Sessions::sweep() {
+  std::vector<std::shared_ptr<Session>> expired;
+  auto now = std::chrono::steady_clock::now();
+
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    sweep(shard, now, expired);
+  }
+
+  return expired.size();
+}
+
+void Sessions::sweep(Shard& shard, std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<Session>>& expired) {
+  shard.lastSweep = now;
+
+  for (auto session = shard.sessions.begin(); session != shard.sessions.end();) {
+    std::unique_lock<std::mutex> lock(session->second->mutex, std::try_to_lock);
+    // A session still held elsewhere has a live channel open, which keeps it current however long it sits idle.
+    if (lock.owns_lock() && now - session->second->lastUsed > timeToLive_ && session->second.use_count() == 1) {
+      lock.unlock();
+      expired.push_back(std::move(session->second));
+      session = shard.sessions.erase(session);
+    } else {
+      ++session;
+    }
+  }
+}
+
+void Sessions::evict(Shard& shard, std::vector<std::shared_ptr<Session>>& expired) {
+  auto oldest = shard.sessions.end();
+  auto oldestUsed = std::chrono::steady_clock::time_point::max();
+
+  for (auto session = shard.sessions.begin(); session != shard.sessions.end(); ++session) {
+    // A session in use right now counts as the most recent.
+    std::unique_lock<std::mutex> lock(session->second->mutex, std::try_to_lock);
+    if (lock.owns_lock() && session->second->lastUsed < oldestUsed) {
+      oldest = session;
+      oldestUsed = session->second->lastUsed;
+    }
+  }
+  if (oldest == shard.sessions.end()) {
+    oldest = shard.sessions.begin();
+  }
+
+  expired.push_back(std::move(oldest->second));
+  shard.sessions.erase(oldest);
+}
+
+std::string_view Sessions::cookie(std::string_view header) {
+  while (!header.empty()) {
+    size_t end = header.find(';');
+    std::string_view pair = header.substr(0, end);
+    while (!pair.empty() && pair.front() == ' ') pair.remove_prefix(1);
+
+    if (pair.size() > cookieName.size() && pair.substr(0, cookieName.size()) == cookieName && pair[cookieName.size()] == '=') {
+      return pair.substr(cookieName.size() + 1);
+    }
+
+    header.remove_prefix(end == std::string_view::npos ? header.size() : end + 1);
+  }
+  return {};
+}
@@ -0,0 +1,186 @@
+#include "cppx/supervisor.hpp"
+
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+Supervisor::Supervisor(size_t workers, std::function<void()> prepare, std::function<int()> work)
+    : prepare_(std::move(prepare)), work_(std::move(work)), workers_(workers) {}
+
+Supervisor::~Supervisor() {
+  if (signalFd_ >= 0) close(signalFd_);
+}
+
+int Supervisor::run() {
+  sigset_t signals;
+  sigemptyset(&signals);
+  for (int number : {SIGINT, SIGTERM, SIGHUP, SIGCHLD}) {
+    sigaddset(&signals, number);
+  }
+  pthread_sigmask(SIG_BLOCK, &signals, &mask_);
+  signalFd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signalFd_ < 0) {
+    std::cerr << "Error: Cannot create signalfd: " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+
+  std::cout << "Supervising " << workers_.size() << " workers (pid " << getpid() << ")" << std::endl;
+  for (size_t slot = 0; slot < workers_.size(); ++slot) {
+    spawn(slot);
+  }
+
+  while (!stopping_ || running() > 0) {
+    int timeout = -1;
+    auto now = Clock::now();
+    for (const auto& worker : workers_) {
+      if (worker.restartAt && !stopping_) {
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(std::max(*worker.restartAt - now, Clock::duration::zero())).count();
+        timeout = timeout < 0 ? static_cast<int>(wait) : std::min(timeout, static_cast<int>(wait));
+      }
+    }
+
+    pollfd descriptor{signalFd_, POLLIN, 0};
+    if (poll(&descriptor, 1, timeout) < 0 && errno != EINTR) {
+      std::cerr << "Error: poll failed: " << std::strerror(errno) << std::endl;
+      signal(SIGTERM);
+    }
+
+    signalfd_siginfo info;
+    while (read(signalFd_, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+      signal(static_cast<int>(info.ssi_signo));
+    }
+    reap();
+
+    // A replacement forks from a freshly scanned route table, so it serves the pages built since the others started.
+    now = Clock::now();
+    bool prepared = false;
+    for (size_t slot = 0; slot < workers_.size() && !stopping_; ++slot) {
+      if (workers_[slot].restartAt && *workers_[slot].restartAt <= now) {
+        if (!prepared) {
+          prepare_();
+          prepared = true;
+        }
+        spawn(slot);
+      }
+    }
+  }
+
+  pthread_sigmask(SIG_SETMASK, &mask_, nullptr);
+  return status_;
+}
+
+void Supervisor::spawn(size_t slot) {
+  pid_t parent = getpid();
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::cerr << "Error: Cannot fork worker: " << std::strerror(errno) << std::endl;
+    workers_[slot].restartAt = Clock::now() + restartDelay;
+    return;
+  }
+
+  if (pid == 0) {
+    close(signalFd_);
+    // Workers never outlive their supervisor, even when it is killed outright.
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != parent) {
+      _exit(0);
+    }
+    pthread_sigmask(SIG_SETMASK, &mask_, nullptr);
+
+    int status = work_();
+    std::cout.flush();
+    std::cerr.flush();
+    _exit(status);
+  }
+
+  workers_[slot] = Worker{pid, Clock::now(), std::nullopt};
+}
+
+void Supervisor::reap() {
+  int status = 0;
+  pid_t pid;
+  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+    if (retiring_.erase(pid)) {
+      roll();
+      continue;
+    }
+
+    auto worker = std::find_if(workers_.begin(), workers_.end(), [pid](const Worker& worker) { return worker.pid == pid; });
+    if (worker == workers_.end()) {
+      continue;
+    }
+    worker->pid = -1;
+    if (stopping_) {
+      continue;
+    }
+
+    bool early = Clock::now() - worker->started < minUptime;
+    if (early && WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+      std::cerr << "Error: Worker " << pid << " exited with status " << WEXITSTATUS(status) << " while starting." << std::endl;
+      status_ = 1;
+      signal(SIGTERM);
+      continue;
+    }
+
+    if (WIFSIGNALED(status)) {
+      std::cerr << "Warning: Worker " << pid << " was killed by " << strsignal(WTERMSIG(status)) << ", restarting." << std::endl;
+    } else {
+      std::cerr << "Warning: Worker " << pid << " exited with status " << WEXITSTATUS(status) << ", restarting." << std::endl;
+    }
+    worker->restartAt = Clock::now() + (early ? Clock::duration(restartDelay) : Clock::duration::zero());
+  }
+}
+
+void Supervisor::roll() {
+  // One worker at a time, so the rest keep serving while it drains and its replacement starts.
+  while (!stopping_ && retiring_.empty() && !rolling_.empty()) {
+    size_t slot = rolling_.front();
+    rolling_.pop_front();
+
+    pid_t previous = workers_[slot].pid;
+    spawn(slot);
+    if (previous > 0) {
+      retiring_.insert(previous);
+      kill(previous, SIGTERM);
+    }
+  }
+}
+
+void Supervisor::signal(int number) {
+  if (number == SIGHUP) {
+    if (!stopping_ && rolling_.empty() && retiring_.empty()) {
+      std::cout << "Restarting " << workers_.size() << " workers" << std::endl;
+      prepare_();
+      for (size_t slot = 0; slot < workers_.size(); ++slot) {
+        rolling_.push_back(slot);
+      }
+      roll();
+    }
+    return;
+  }
+  if (number != SIGINT && number != SIGTERM) {
+    return;
+  }
+
+  // Workers drain their requests on SIGTERM; a second stop signal does not wait for them.
+  int forward = stopping_ ? SIGKILL : SIGTERM;
+  stopping_ = true;
+  rolling_.clear();
+  for (const auto& worker : workers_) {
+    if (worker.pid > 0) kill(worker.pid, forward);
+  }
+  for (pid_t pid : retiring_) {
+    kill(pid, forward);
+  }
+}
+
+size_t Supervisor::running() const {
+  return retiring_.size() + std::count_if(workers_.begin(), workers_.end(), [](const Worker& worker) { return worker.pid > 0; });
+}
@@ -0,0 +1,116 @@
+#include "cppx/thread_pool.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+thread_local const void* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads, bool pin) {
+  threads = threads == 0 ? 1 : threads;
+
+  for (size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this, i, pin] { work(i, pin); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t ThreadPool::defaultThreads() {
+  size_t threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+void ThreadPool::submit(Task task) {
+  // Work spawned by a worker stays on its own queue; everything else is spread round-robin.
+  size_t index = currentPool == this ? currentIndex : next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+
+  queued_.fetch_add(1, std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_seq_cst) > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_one();
+  }
+}
+
+// Owners take the oldest task to keep request latency fair; thieves take the newest to stay off the owner's end.
+bool ThreadPool::take(size_t index, Task& task) {
+  {
+    Queue& own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  for (size_t offset = 1; offset < queues_.size(); ++offset) {
+    Queue& victim = *queues_[(index + offset) % queues_.size()];
+    std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+    if (lock.owns_lock() && !victim.tasks.empty()) {
+      task = std::move(victim.tasks.back());
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::work(size_t index, bool pin) {
+  currentPool = this;
+  currentIndex = index;
+
+#if defined(__linux__)
+  if (pin) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(index % defaultThreads(), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+#else
+  (void)pin;
+#endif
+
+  Task task;
+  while (true) {
+    if (queued_.load(std::memory_order_relaxed) > 0 && take(index, task)) {
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    condition_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_seq_cst) > 0; });
+    sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+    if (stopping_ && queued_.load() == 0) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,268 @@
+#include "cppx/trace.hpp"
+
+#include <unistd.h>
+
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Powers of four from 1 up: microseconds for render time, bytes for output size, and plain counts for JSON values.
+constexpr size_t bucketCount = 12;
+
+struct Histogram {
+  std::array<std::atomic<uint64_t>, bucketCount + 1> counts{};
+  std::atomic<uint64_t> sum{0};
+
+  // Only the owning thread adds, so plain loads and stores keep the counts exact without a locked instruction.
+  void add(uint64_t value) {
+    size_t bucket = 0;
+    for (uint64_t bound = 1; bucket < bucketCount && value > bound; bound *= 4) {
+      bucket++;
+    }
+    counts[bucket].store(counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+};
+
+struct Route {
+  Histogram micros;
+  Histogram bytes;
+  Histogram jsonValues;
+};
+
+struct Event {
+  const char* name = nullptr;
+  std::string detail;
+  uint64_t start = 0;
+  uint64_t duration = 0;
+};
+
+struct Buffer {
+  size_t thread = 0;
+  bool active = true;
+  std::vector<Event> events;
+  size_t written = 0;
+  std::array<std::atomic<uint64_t>, Trace::counterCount> counters{};
+  // Held by the owner only to add a route, and by readers while they walk the routes.
+  std::mutex mutex;
+  std::map<std::string, Route, std::less<>> routes;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<Buffer>> registry;
+
+// A thread's buffer outlives it for export, and goes to the next new thread after that.
+class Holder {
+ public:
+  ~Holder() {
+    if (buffer_) {
+      std::lock_guard<std::mutex> lock(registryMutex);
+      buffer_->active = false;
+    }
+  }
+
+  Buffer& get() {
+    if (!buffer_) {
+      std::lock_guard<std::mutex> lock(registryMutex);
+      for (const auto& buffer : registry) {
+        if (!buffer->active) {
+          buffer_ = buffer.get();
+          break;
+        }
+      }
+      if (!buffer_) {
+        registry.push_back(std::make_unique<Buffer>());
+        buffer_ = registry.back().get();
+        buffer_->thread = registry.size();
+      }
+      buffer_->active = true;
+    }
+    return *buffer_;
+  }
+
+ private:
+  Buffer* buffer_ = nullptr;
+};
+
+thread_local Holder holder;
+thread_local Trace::Sample* currentSample = nullptr;
+
+void escape(std::string_view text, std::ostream& output) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      output << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      output << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15];
+    } else {
+      output << c;
+    }
+  }
+}
+
+}  // namespace
+
+#if !defined(CPPX_NO_TRACE)
+
+Trace::Sample::Sample(std::string_view route) : route_(route), previous_(currentSample) {
+  if (metrics_.load(std::memory_order_relaxed)) {
+    start_ = now();
+    currentSample = this;
+  }
+}
+
+Trace::Sample::~Sample() {
+  if (!start_) {
+    return;
+  }
+  currentSample = previous_;
+
+  Buffer& buffer = holder.get();
+  auto route = buffer.routes.find(route_);
+  if (route == buffer.routes.end()) {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    route = buffer.routes.try_emplace(std::string(route_)).first;
+  }
+  route->second.micros.add((now() - start_) / 1000);
+  route->second.bytes.add(bytes);
+  route->second.jsonValues.add(jsonValues);
+}
+
+Trace::Sample* Trace::Sample::current() { return currentSample; }
+
+#endif
+
+void Trace::record(const char* name, std::string_view detail, uint64_t start, uint64_t end) {
+  Buffer& buffer = holder.get();
+  if (buffer.events.empty()) {
+    buffer.events.resize(eventCapacity);
+  }
+  Event& event = buffer.events[buffer.written++ % eventCapacity];
+  event.name = name;
+  event.detail.assign(detail);
+  event.start = start;
+  event.duration = end - start;
+}
+
+void Trace::add(Counter counter, uint64_t value) {
+  auto& slot = holder.get().counters[static_cast<size_t>(counter)];
+  slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+bool Trace::write(const std::filesystem::path& path) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cerr << "Error: Cannot write trace to " << path << std::endl;
+    return false;
+  }
+
+  pid_t pid = getpid();
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (const auto& buffer : registry) {
+    // A full buffer has overwritten its oldest spans, so it starts at the oldest one left.
+    size_t begin = buffer->written > eventCapacity ? buffer->written - eventCapacity : 0;
+    for (size_t i = begin; i < buffer->written; ++i) {
+      const Event& event = buffer->events[i % eventCapacity];
+      file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"cppx\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->thread
+           << ",\"ts\":" << event.start / 1000 << "." << event.start % 1000 / 100 << ",\"dur\":" << event.duration / 1000 << "." << event.duration % 1000 / 100;
+      if (!event.detail.empty()) {
+        file << ",\"args\":{\"detail\":\"";
+        escape(event.detail, file);
+        file << "\"}";
+      }
+      file << "}";
+      first = false;
+    }
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+std::string Trace::prometheus() {
+  struct Totals {
+    std::array<uint64_t, bucketCount + 1> counts{};
+    uint64_t sum = 0;
+
+    void add(const Histogram& histogram) {
+      for (size_t i = 0; i <= bucketCount; ++i) {
+        counts[i] += histogram.counts[i].load(std::memory_order_relaxed);
+      }
+      sum += histogram.sum.load(std::memory_order_relaxed);
+    }
+  };
+
+  std::array<uint64_t, counterCount> counters{};
+  std::map<std::string, std::array<Totals, 3>> routes;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& buffer : registry) {
+      for (size_t i = 0; i < counterCount; ++i) {
+        counters[i] += buffer->counters[i].load(std::memory_order_relaxed);
+      }
+      std::lock_guard<std::mutex> routesLock(buffer->mutex);
+      for (const auto& [name, route] : buffer->routes) {
+        auto& totals = routes[name];
+        totals[0].add(route.micros);
+        totals[1].add(route.bytes);
+        totals[2].add(route.jsonValues);
+      }
+    }
+  }
+
+  std::ostringstream output;
+  output << std::setprecision(12);
+  constexpr std::array<std::array<const char*, 2>, counterCount> counterNames = {{
+      {"cppx_requests_total", "Page requests handled."},
+      {"cppx_render_cache_hits_total", "Requests answered from the render cache."},
+      {"cppx_reloads_total", "Route table reloads."},
+      {"cppx_sent_bytes_total", "Bytes written to clients."},
+  }};
+  for (size_t i = 0; i < counterCount; ++i) {
+    output << "# HELP " << counterNames[i][0] << " " << counterNames[i][1] << "\n# TYPE " << counterNames[i][0] << " counter\n" << counterNames[i][0] << " " << counters[i] << "\n";
+  }
+
+  // Render time is kept in microseconds and reported in seconds, as Prometheus expects.
+  constexpr std::array<std::array<const char*, 2>, 3> histogramNames = {{
+      {"cppx_render_seconds", "Time to build and serialize a page."},
+      {"cppx_render_bytes", "Serialized size of a page."},
+      {"cppx_render_json_values", "JSON strings, arrays and objects a page built."},
+  }};
+  for (size_t metric = 0; metric < 3; ++metric) {
+    const char* name = histogramNames[metric][0];
+    double scale = metric == 0 ? 1e-6 : 1;
+    output << "# HELP " << name << " " << histogramNames[metric][1] << "\n# TYPE " << name << " histogram\n";
+    for (const auto& [route, totals] : routes) {
+      const Totals& histogram = totals[metric];
+      uint64_t cumulative = 0;
+      uint64_t bound = 1;
+      for (size_t i = 0; i <= bucketCount; ++i, bound *= 4) {
+        cumulative += histogram.counts[i];
+        output << name << "_bucket{route=\"";
+        escape(route, output);
+        output << "\",le=\"";
+        if (i == bucketCount) {
+          output << "+Inf";
+        } else {
+          output << static_cast<double>(bound) * scale;
+        }
+        output << "\"} " << cumulative << "\n";
+      }
+      output << name << "_sum{route=\"";
+      escape(route, output);
+      output << "\"} " << static_cast<double>(histogram.sum) * scale << "\n" << name << "_count{route=\"";
+      escape(route, output);
+      output << "\"} " << cumulative << "\n";
+    }
+  }
+
+  return output.str();
+}
@@ -0,0 +1,201 @@
+#include "cppx/watcher.hpp"
+
+#include <iostream>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+Watcher::Watcher(const std::vector<std::filesystem::path>& directories, std::chrono::milliseconds debounce) : directories_(directories), debounce_(debounce) {
+#if defined(__linux__)
+  fd_ = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  interruptFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd_ < 0) {
+    std::cerr << "Warning: inotify is unavailable, falling back to polling." << std::endl;
+  }
+#endif
+
+  for (const auto& directory : directories_) {
+    if (std::filesystem::is_directory(directory)) {
+      addWatch(directory, nullptr);
+    }
+  }
+}
+
+Watcher::~Watcher() {
+#if defined(__linux__)
+  for (int fd : {fd_, interruptFd_}) {
+    if (fd >= 0) close(fd);
+  }
+#endif
+}
+
+void Watcher::interrupt() {
+  interrupted_ = true;
+#if defined(__linux__)
+  if (interruptFd_ >= 0) {
+    uint64_t value = 1;
+    (void)!write(interruptFd_, &value, sizeof(value));
+  }
+#endif
+}
+
+void Watcher::addWatch(const std::filesystem::path& directory, std::set<std::filesystem::path>* created) {
+  std::error_code error;
+
+#if defined(__linux__)
+  if (fd_ >= 0) {
+    const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    int wd = inotify_add_watch(fd_, directory.c_str(), mask);
+    if (wd < 0) {
+      std::cerr << "Warning: Cannot watch " << directory << std::endl;
+    } else {
+      watches_[wd] = directory;
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+      if (entry.is_directory()) {
+        addWatch(entry.path(), created);
+      } else if (created && entry.is_regular_file()) {
+        created->insert(entry.path());
+      }
+    }
+    return;
+  }
+#endif
+
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+    if (entry.is_regular_file()) {
+      snapshot_[entry.path().string()] = entry.last_write_time();
+    }
+  }
+}
+
+std::vector<std::filesystem::path> Watcher::wait() {
+  std::set<std::filesystem::path> changed;
+  overflowed_ = false;
+
+  if (fd_ >= 0) {
+    while (changed.empty() && !overflowed_ && !interrupted_) {
+      readEvents(-1, changed);
+    }
+    while (!interrupted_ && readEvents(static_cast<int>(debounce_.count()), changed)) {
+    }
+  } else {
+    while (!interrupted_ && !pollSnapshot(changed)) {
+      std::this_thread::sleep_for(debounce_);
+    }
+    do {
+      std::this_thread::sleep_for(debounce_);
+    } while (!interrupted_ && pollSnapshot(changed));
+  }
+
+  if (interrupted_) {
+    overflowed_ = false;
+    return {};
+  }
+
+  return std::vector<std::filesystem::path>(changed.begin(), changed.end());
+}
+
+bool Watcher::readEvents(int timeout, std::set<std::filesystem::path>& changed) {
+#if defined(__linux__)
+  pollfd descriptors[] = {{fd_, POLLIN, 0}, {interruptFd_, POLLIN, 0}};
+  if (poll(descriptors, interruptFd_ >= 0 ? 2 : 1, timeout) <= 0 || descriptors[1].revents) {
+    return false;
+  }
+
+  alignas(inotify_event) char buffer[16 * 1024];
+  bool received = false;
+  bool overflowed = false;
+
+  while (true) {
+    ssize_t length = read(fd_, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+    received = true;
+
+    for (char* cursor = buffer; cursor < buffer + length;) {
+      auto* event = reinterpret_cast<inotify_event*>(cursor);
+      cursor += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflowed = true;
+        continue;
+      }
+
+      if (event->mask & IN_IGNORED) {
+        watches_.erase(event->wd);
+        continue;
+      }
+
+      auto watch = watches_.find(event->wd);
+      if (watch == watches_.end() || event->len == 0) {
+        continue;
+      }
+
+      std::filesystem::path path = watch->second / event->name;
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          addWatch(path, &changed);
+        }
+      } else {
+        changed.insert(path);
+      }
+    }
+  }
+
+  if (overflowed) {
+    overflowed_ = true;
+    // Directories created while the queue was full were never watched.
+    for (const auto& directory : directories_) {
+      if (std::filesystem::is_directory(directory)) {
+        addWatch(directory, &changed);
+      }
+    }
+  }
+
+  return received;
+#else
+  (void)timeout;
+  (void)changed;
+  return false;
+#endif
+}
+
+bool Watcher::pollSnapshot(std::set<std::filesystem::path>& changed) {
+  std::unordered_map<std::string, std::filesystem::file_time_type> current;
+  std::error_code error;
+
+  for (const auto& directory : directories_) {
+    if (!std::filesystem::is_directory(directory)) continue;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+      if (entry.is_regular_file()) {
+        current[entry.path().string()] = entry.last_write_time();
+      }
+    }
+  }
+
+  bool found = false;
+  for (const auto& [path, time] : current) {
+    auto previous = snapshot_.find(path);
+    if (previous == snapshot_.end() || previous->second != time) {
+      changed.insert(path);
+      found = true;
+    }
+  }
+  for (const auto& [path, time] : snapshot_) {
+    if (current.find(path) == current.end()) {
+      changed.insert(path);
+      found = true;
+    }
+  }
+
+  snapshot_ = std::move(current);
+  return found;
+}
@@ -0,0 +1,150 @@
+#include "cppx/websocket.hpp"
+
+#include <array>
+
+std::string WebSocket::acceptKey(std::string_view key) {
+  static constexpr std::string_view guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  std::string input(key);
+  input += guid;
+  return base64(sha1(input));
+}
+
+void WebSocket::frame(Opcode opcode, std::string_view payload, std::string& output) {
+  output += static_cast<char>(0x80 | static_cast<uint8_t>(opcode));
+
+  if (payload.size() < 126) {
+    output += static_cast<char>(payload.size());
+  } else if (payload.size() <= 0xFFFF) {
+    output += static_cast<char>(126);
+    output += static_cast<char>(payload.size() >> 8);
+    output += static_cast<char>(payload.size() & 0xFF);
+  } else {
+    output += static_cast<char>(127);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      output += static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF);
+    }
+  }
+
+  output += payload;
+}
+
+WebSocket::ParseResult WebSocket::parse(std::string_view buffer, Frame& frame, size_t& consumed) {
+  if (buffer.size() < 2) {
+    return ParseResult::Incomplete;
+  }
+
+  auto byte = [&](size_t index) { return static_cast<uint8_t>(buffer[index]); };
+
+  // Clients must mask every frame.
+  if (!(byte(1) & 0x80)) {
+    return ParseResult::Invalid;
+  }
+
+  uint64_t length = byte(1) & 0x7F;
+  size_t offset = 2;
+  if (length == 126) {
+    if (buffer.size() < 4) return ParseResult::Incomplete;
+    length = (static_cast<uint64_t>(byte(2)) << 8) | byte(3);
+    offset = 4;
+  } else if (length == 127) {
+    if (buffer.size() < 10) return ParseResult::Incomplete;
+    length = 0;
+    for (size_t i = 2; i < 10; ++i) length = (length << 8) | byte(i);
+    offset = 10;
+  }
+
+  if (length > maxPayloadSize) {
+    return ParseResult::Invalid;
+  }
+  if (buffer.size() < offset + 4 + length) {
+    return ParseResult::Incomplete;
+  }
+
+  const char* mask = buffer.data() + offset;
+  offset += 4;
+
+  frame.final = byte(0) & 0x80;
+  frame.opcode = static_cast<Opcode>(byte(0) & 0x0F);
+  frame.payload.assign(buffer.data() + offset, length);
+  for (size_t i = 0; i < length; ++i) {
+    frame.payload[i] ^= mask[i % 4];
+  }
+
+  consumed = offset + length;
+  return ParseResult::Complete;
+}
+
+std::string WebSocket::sha1(std::string_view input) {
+  std::array<uint32_t, 5> state = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+  std::string message(input);
+  uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+  message += static_cast<char>(0x80);
+  while (message.size() % 64 != 56) message += '\0';
+  for (int shift = 56; shift >= 0; shift -= 8) message += static_cast<char>((bits >> shift) & 0xFF);
+
+  auto rotate = [](uint32_t value, int count) { return (value << count) | (value >> (32 - count)); };
+
+  for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+    uint32_t words[80];
+    for (int i = 0; i < 16; ++i) {
+      words[i] = 0;
+      for (int j = 0; j < 4; ++j) words[i] = (words[i] << 8) | static_cast<uint8_t>(message[chunk + i * 4 + j]);
+    }
+    for (int i = 16; i < 80; ++i) words[i] = rotate(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; ++i) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotate(a, 5) + f + e + k + words[i];
+      e = d;
+      d = c;
+      c = rotate(b, 30);
+      b = a;
+      a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+  }
+
+  std::string digest;
+  for (uint32_t value : state) {
+    for (int shift = 24; shift >= 0; shift -= 8) digest += static_cast<char>((value >> shift) & 0xFF);
+  }
+  return digest;
+}
+
+std::string WebSocket::base64(std::string_view input) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string output;
+
+  for (size_t i = 0; i < input.size(); i += 3) {
+    uint32_t value = static_cast<uint8_t>(input[i]) << 16;
+    if (i + 1 < input.size()) value |= static_cast<uint8_t>(input[i + 1]) << 8;
+    if (i + 2 < input.size()) value |= static_cast<uint8_t>(input[i + 2]);
+
+    output += alphabet[(value >> 18) & 63];
+    output += alphabet[(value >> 12) & 63];
+    output += i + 1 < input.size() ? alphabet[(value >> 6) & 63] : '=';
+    output += i + 2 < input.size() ? alphabet[value & 63] : '=';
+  }
+
+  return output;
+}